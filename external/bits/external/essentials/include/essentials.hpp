@@ -6,12 +6,19 @@
 #include <fstream>
 #include <numeric>
 #include <random>
+#include <string_view>
+#include <tuple>
 #include <type_traits>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>  // for std::exception_ptr
 #include <dirent.h>
 #include <cstring>
 #include <locale>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/resource.h>
@@ -23,6 +30,10 @@
 #include <cxxabi.h>  // for name demangling
 #endif
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>  // for __rdtsc/__rdtscp
+#endif
+
 #include "utils/instrumentation.hpp"
 
 namespace essentials {
@@ -58,14 +69,14 @@ struct is_pod {
 }
 
 template <typename T>
-static size_t vec_bytes(T const& vec) {
-    return vec.size() * sizeof(vec.front()) + sizeof(typename T::size_type);
+static constexpr size_t vec_bytes(T const& vec) noexcept {
+    return vec.size() * sizeof(typename T::value_type) + sizeof(typename T::size_type);
 }
 
 template <typename T>
-static size_t pod_bytes(T const& pod) {
+static constexpr size_t pod_bytes(T const&) noexcept {
     static_assert(is_pod<T>::value);
-    return sizeof(pod);
+    return sizeof(T);
 }
 
 [[maybe_unused]] static size_t file_size(char const* filename) {
@@ -81,36 +92,60 @@ static size_t pod_bytes(T const& pod) {
 }
 
 template <typename WordType = uint64_t>
-static uint64_t words_for(uint64_t bits) {
-    uint64_t word_bits = sizeof(WordType) * 8;
+static constexpr uint64_t words_for(uint64_t bits) {
+    constexpr uint64_t word_bits = sizeof(WordType) * 8;
     return (bits + word_bits - 1) / word_bits;
 }
 
+/* word_bits is a power of two for the common word types: spell the
+   round-up as a shift so no division survives at any call site */
+template <>
+constexpr uint64_t words_for<uint64_t>(uint64_t bits) {
+    return (bits + 63) >> 6;
+}
+
+template <>
+constexpr uint64_t words_for<uint32_t>(uint64_t bits) {
+    return (bits + 31) >> 5;
+}
+
 template <typename T>
 static inline void do_not_optimize_away(T&& value) {
     asm volatile("" : "+r"(value));
 }
 
 [[maybe_unused]] static uint64_t maxrss_in_bytes() {
-    struct rusage ru;
-    if (getrusage(RUSAGE_SELF, &ru) == 0) {
-        // NOTE: ru_maxrss is in kilobytes on Linux, but not on Apple...
+    /* getrusage is a genuine syscall and peak RSS moves slowly, so a
+       measurement loop sampling this per iteration would be dominated
+       by it: refresh the cached value at most once per second */
+    static thread_local uint64_t last_val = 0;
+    static thread_local std::chrono::steady_clock::time_point last_sample;
+    auto now = std::chrono::steady_clock::now();
+    if (last_val == 0 || now - last_sample >= std::chrono::seconds(1)) {
+        struct rusage ru;
+        if (getrusage(RUSAGE_SELF, &ru) == 0) {
+            // NOTE: ru_maxrss is in kilobytes on Linux, but not on Apple...
 #ifdef __APPLE__
-        return ru.ru_maxrss;
+            last_val = ru.ru_maxrss;
+#else
+            last_val = ru.ru_maxrss * 1000;
 #endif
-        return ru.ru_maxrss * 1000;
+        }
+        last_sample = now;
     }
-    return 0;
+    return last_val;
 }
 
 template <typename T>
-static void load_pod(std::istream& is, T& val) {
+[[gnu::always_inline]] static inline void load_pod(std::istream& is, T& val) {
     static_assert(is_pod<T>::value);
     is.read(reinterpret_cast<char*>(&val), sizeof(T));
 }
 
 template <typename T, typename Allocator>
 static void load_vec(std::istream& is, std::vector<T, Allocator>& vec) {
+    static_assert(!std::is_same<T, bool>::value,
+                  "store packed uint64_t words plus a bit count instead of vector<bool>");
     size_t n;
     load_pod(is, n);
     vec.resize(n);
@@ -118,7 +153,7 @@ static void load_vec(std::istream& is, std::vector<T, Allocator>& vec) {
 }
 
 template <typename T>
-static void save_pod(std::ostream& os, T const& val) {
+[[gnu::always_inline]] static inline void save_pod(std::ostream& os, T const& val) {
     static_assert(is_pod<T>::value);
     os.write(reinterpret_cast<char const*>(&val), sizeof(T));
 }
@@ -126,6 +161,8 @@ static void save_pod(std::ostream& os, T const& val) {
 template <typename T, typename Allocator>
 static void save_vec(std::ostream& os, std::vector<T, Allocator> const& vec) {
     static_assert(is_pod<T>::value);
+    static_assert(!std::is_same<T, bool>::value,
+                  "store packed uint64_t words plus a bit count instead of vector<bool>");
     size_t n = vec.size();
     save_pod(os, n);
     os.write(reinterpret_cast<char const*>(vec.data()),
@@ -134,7 +171,10 @@ static void save_vec(std::ostream& os, std::vector<T, Allocator> const& vec) {
 
 struct json_lines {
     struct property {
-        property(std::string n, std::string v)
+        /* views avoid materializing a temporary std::string per argument:
+           literal names land directly in the stored string (SSO for the
+           short ones, so typically no allocation at all) */
+        property(std::string_view n, std::string_view v)
             : name(n)
             , value(v) {}
 
@@ -147,12 +187,12 @@ struct json_lines {
     }
 
     template <typename T>
-    void add(std::string name, T value) {
+    void add(std::string_view name, T value) {
         if (!m_properties.size()) {
             new_line();
         }
-        if constexpr (std::is_same<T, char const*>::value) {
-            m_properties.back().emplace_back(name, value);
+        if constexpr (std::is_convertible<T, std::string_view>::value) {
+            m_properties.back().emplace_back(name, std::string_view(value));
         } else if constexpr (std::is_same<T, bool>::value) {
             m_properties.back().emplace_back(name, value ? "true" : "false");
         } else {
@@ -177,27 +217,78 @@ struct json_lines {
 private:
     std::vector<std::vector<property>> m_properties;
 
-    template <typename T>
-    void print_line_to(std::vector<property> const& properties, T& device) const {
-        device << "{";
+    /* build each line in one std::string and emit it with a single
+       device.write, instead of one streambuf traversal per token */
+    static void append_line(std::vector<property> const& properties, std::string& s) {
+        s.push_back('{');
         for (uint64_t i = 0; i != properties.size(); ++i) {
             auto const& p = properties[i];
-            device << "\"" << p.name << "\": \"" << p.value << "\"";
+            s.push_back('"');
+            s.append(p.name);
+            s.append("\": \"");
+            s.append(p.value);
+            s.push_back('"');
             if (i != properties.size() - 1) {
-                device << ", ";
+                s.append(", ");
             }
         }
-        device << "}\n";
+        s.append("}\n");
+    }
+
+    template <typename T>
+    void print_line_to(std::vector<property> const& properties, T& device) const {
+        std::string s;
+        s.reserve(properties.size() * 32 + 2);
+        append_line(properties, s);
+        device.write(s.data(), s.size());
     }
 
     template <typename T>
     void print_to(T& device) const {
+        std::string s;
         for (auto const& properties : m_properties) {
-            print_line_to(properties, device);
+            s.reserve(s.size() + properties.size() * 32 + 2);
+            append_line(properties, s);
         }
+        device.write(s.data(), s.size());
     }
 };
 
+#ifdef __AVX2__
+[[maybe_unused]] static double simd_min(double const* p, size_t n) {
+    __m256d acc = _mm256_loadu_pd(p);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) acc = _mm256_min_pd(acc, _mm256_loadu_pd(p + i));
+    __m128d lo = _mm_min_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    double r = _mm_cvtsd_f64(_mm_min_sd(lo, _mm_unpackhi_pd(lo, lo)));
+    for (; i != n; ++i) r = std::min(r, p[i]);
+    return r;
+}
+
+[[maybe_unused]] static double simd_max(double const* p, size_t n) {
+    __m256d acc = _mm256_loadu_pd(p);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) acc = _mm256_max_pd(acc, _mm256_loadu_pd(p + i));
+    __m128d lo = _mm_max_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    double r = _mm_cvtsd_f64(_mm_max_sd(lo, _mm_unpackhi_pd(lo, lo)));
+    for (; i != n; ++i) r = std::max(r, p[i]);
+    return r;
+}
+
+[[maybe_unused]] static double simd_sum(double const* p, size_t n) {
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) acc = _mm256_add_pd(acc, _mm256_loadu_pd(p + i));
+    __m128d lo = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    double r = _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+    for (; i != n; ++i) r += p[i];
+    return r;
+}
+#endif
+
+/* below this many runs the scalar std reductions win (setup overhead) */
+constexpr size_t simd_reduction_threshold = 32;
+
 template <typename ClockType, typename DurationType>
 struct timer {
     void start() {
@@ -214,15 +305,31 @@ struct timer {
         return m_timings.size();
     }
 
+    /* benchmark drivers that know the run count up front can avoid the
+       geometric reallocations of m_timings during the measured loop */
+    void reserve(size_t num_runs) {
+        m_timings.reserve(num_runs);
+    }
+
     void reset() {
         m_timings.clear();
     }
 
     double min() const {
+#ifdef __AVX2__
+        if (m_timings.size() >= simd_reduction_threshold) {
+            return simd_min(m_timings.data(), m_timings.size());
+        }
+#endif
         return *std::min_element(m_timings.begin(), m_timings.end());
     }
 
     double max() const {
+#ifdef __AVX2__
+        if (m_timings.size() >= simd_reduction_threshold) {
+            return simd_max(m_timings.data(), m_timings.size());
+        }
+#endif
         return *std::max_element(m_timings.begin(), m_timings.end());
     }
 
@@ -245,6 +352,11 @@ struct timer {
     }
 
     double elapsed() {
+#ifdef __AVX2__
+        if (m_timings.size() >= simd_reduction_threshold) {
+            return simd_sum(m_timings.data(), m_timings.size());
+        }
+#endif
         return std::accumulate(m_timings.begin(), m_timings.end(), 0.0);
     }
 
@@ -262,6 +374,80 @@ typedef std::chrono::high_resolution_clock clock_type;
 typedef std::chrono::microseconds duration_type;
 typedef timer<clock_type, duration_type> timer_type;
 
+#if defined(__x86_64__) || defined(__i386__)
+/* Timer variant for measuring intervals shorter than the ~20-40ns cost
+   of a clock_gettime-based timestamp: reads the TSC directly (lfence
+   fences against instruction reordering) and converts ticks to
+   microseconds with a once-per-process calibration against the steady
+   clock. Assumes the measured thread stays on one core (TSC skew
+   across sockets is not compensated). */
+struct rdtsc_timer {
+    void start() {
+        _mm_lfence();
+        m_start = __rdtsc();
+    }
+
+    void stop() {
+        unsigned aux;
+        uint64_t t = __rdtscp(&aux);
+        _mm_lfence();
+        m_timings.push_back(t - m_start);
+    }
+
+    size_t runs() const {
+        return m_timings.size();
+    }
+
+    void reserve(size_t num_runs) {
+        m_timings.reserve(num_runs);
+    }
+
+    void reset() {
+        m_timings.clear();
+    }
+
+    double min() const {
+        return *std::min_element(m_timings.begin(), m_timings.end()) / ticks_per_microsec();
+    }
+
+    double max() const {
+        return *std::max_element(m_timings.begin(), m_timings.end()) / ticks_per_microsec();
+    }
+
+    double elapsed() {
+        return std::accumulate(m_timings.begin(), m_timings.end(), uint64_t(0)) /
+               ticks_per_microsec();
+    }
+
+    double average() {
+        return elapsed() / runs();
+    }
+
+    static double ticks_per_microsec() {
+        static const double ticks = calibrate();
+        return ticks;
+    }
+
+private:
+    uint64_t m_start;
+    std::vector<uint64_t> m_timings;
+
+    static double calibrate() {
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t c0 = __rdtsc();
+        // spin for ~10ms: long enough to make timestamp overhead noise
+        uint64_t elapsed_nanosec = 0;
+        do {
+            elapsed_nanosec = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now() - t0)
+                                  .count();
+        } while (elapsed_nanosec < 10 * 1000 * 1000);
+        uint64_t c1 = __rdtsc();
+        return (c1 - c0) * 1000.0 / elapsed_nanosec;
+    }
+};
+#endif
+
 [[maybe_unused]] static unsigned get_random_seed() {
     return std::chrono::system_clock::now().time_since_epoch().count();
 }
@@ -269,42 +455,215 @@ typedef timer<clock_type, duration_type> timer_type;
 template <typename IntType>
 struct uniform_int_rng {
     uniform_int_rng(IntType from, IntType to, unsigned seed = 13)
-        : m_rng(seed)
-        , m_distr(from, to) {}
+        : m_from(from)
+        , m_range(static_cast<uint64_t>(to) - static_cast<uint64_t>(from) + 1) {
+        /* expand the seed through splitmix64 so the 256-bit state is
+           well mixed and never all-zero */
+        uint64_t z = seed;
+        for (auto& s : m_state) {
+            z += 0x9e3779b97f4a7c15ull;
+            uint64_t x = z;
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+            s = x ^ (x >> 31);
+        }
+    }
 
     IntType gen() {
-        return m_distr(m_rng);
+        uint64_t x = next();
+        // m_range == 0 means the full 64-bit interval (to - from + 1 wrapped)
+        if (m_range == 0) return static_cast<IntType>(x);
+        // Lemire's multiply-shift range reduction: no division, no rejection loop
+        uint64_t bounded = static_cast<uint64_t>((static_cast<__uint128_t>(x) * m_range) >> 64);
+        return static_cast<IntType>(static_cast<uint64_t>(m_from) + bounded);
     }
 
 private:
-    std::mt19937_64 m_rng;
-    std::uniform_int_distribution<IntType> m_distr;
+    IntType m_from;
+    uint64_t m_range;
+    uint64_t m_state[4];  // xoshiro256**: 32 bytes of state vs. mt19937_64's 2.5 KiB
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t next() {
+        uint64_t const result = rotl(m_state[1] * 5, 7) * 9;
+        uint64_t const t = m_state[1] << 17;
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = rotl(m_state[3], 45);
+        return result;
+    }
+};
+
+/* Types may expose their serialized members as a tuple of references,
+       constexpr auto fields() { return std::tie(m_a, m_b, m_c); }
+   in addition to the usual visit() method. Visitors that understand the
+   tuple (generic_loader/generic_saver) coalesce runs of POD fields that
+   are adjacent in memory into one bulk read/write instead of one call
+   per field; everything else keeps using visit(). */
+template <typename T, typename = void>
+struct has_fields : std::false_type {};
+
+template <typename T>
+struct has_fields<T, std::void_t<decltype(std::declval<T&>().fields())>> : std::true_type {};
+
+template <typename... Ts>
+[[maybe_unused]] static bool fields_are_adjacent(std::tuple<Ts&...> const& t) {
+    char const* expected = nullptr;
+    bool adjacent = true;
+    std::apply(
+        [&](auto&... f) {
+            ((adjacent &= (expected == nullptr || reinterpret_cast<char const*>(&f) == expected),
+              expected = reinterpret_cast<char const*>(&f) + sizeof(f)),
+             ...);
+        },
+        t);
+    return adjacent;
+}
+
+/* Buffered wrapper around a file descriptor: services many small reads
+   from a user-owned buffer with plain memcpy, refilling with read(2),
+   so per-field loads do not pay the std::streambuf virtual-call and
+   sentry overhead. */
+struct buffered_reader {
+    static const size_t buffer_size = 65536;
+
+    buffered_reader(char const* filename)
+        : m_buf(std::make_unique<uint8_t[]>(buffer_size))
+        , m_pos(0)
+        , m_fill(0)
+        , m_consumed(0) {
+        m_fd = ::open(filename, O_RDONLY);
+        if (m_fd == -1) {
+            throw std::runtime_error(
+                "Error in opening binary "
+                "file.");
+        }
+#ifdef POSIX_FADV_SEQUENTIAL
+        ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+
+    ~buffered_reader() {
+        if (m_fd != -1) ::close(m_fd);
+    }
+
+    buffered_reader(buffered_reader const&) = delete;
+    buffered_reader& operator=(buffered_reader const&) = delete;
+
+    void read(void* dst, size_t n) {
+        uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+        while (n > 0) {
+            if (m_pos == m_fill) {
+                if (n >= buffer_size) {
+                    // large request: bypass the buffer
+                    read_fully(out, n);
+                    return;
+                }
+                refill();
+            }
+            size_t take = std::min(n, m_fill - m_pos);
+            memcpy(out, m_buf.get() + m_pos, take);
+            m_pos += take;
+            m_consumed += take;
+            out += take;
+            n -= take;
+        }
+    }
+
+    /* advance past n bytes without delivering them; beyond the buffered
+       remainder this is a single lseek */
+    void skip(size_t n) {
+        size_t avail = m_fill - m_pos;
+        if (n <= avail) {
+            m_pos += n;
+            m_consumed += n;
+            return;
+        }
+        m_pos = m_fill;
+        m_consumed += avail;
+        n -= avail;
+        // with the buffer drained, the fd position equals m_consumed
+        if (::lseek(m_fd, n, SEEK_CUR) == -1) throw std::runtime_error("lseek failed");
+        m_consumed += n;
+    }
+
+    size_t consumed() const {
+        return m_consumed;
+    }
+
+    int fd() const {
+        return m_fd;
+    }
+
+private:
+    int m_fd;
+    std::unique_ptr<uint8_t[]> m_buf;
+    size_t m_pos, m_fill;
+    size_t m_consumed;
+
+    void refill() {
+        ssize_t got = ::read(m_fd, m_buf.get(), buffer_size);
+        if (got <= 0) throw std::runtime_error("read failed");
+        m_pos = 0;
+        m_fill = static_cast<size_t>(got);
+    }
+
+    void read_fully(uint8_t* out, size_t n) {
+        while (n > 0) {
+            ssize_t got = ::read(m_fd, out, n);
+            if (got <= 0) throw std::runtime_error("read failed");
+            out += got;
+            m_consumed += got;
+            n -= static_cast<size_t>(got);
+        }
+    }
 };
 
 struct generic_loader {
-    generic_loader(std::istream& is)
+    generic_loader(buffered_reader& br)
         : m_num_bytes_pods(0)
         , m_num_bytes_vecs_of_pods(0)
-        , m_is(is) {}
+        , m_br(br) {}
 
     template <typename T>
-    void visit(T& val) {
+    inline void visit(T& val) {
         if constexpr (is_pod<T>::value) {
-            load_pod(m_is, val);
+            m_br.read(&val, sizeof(T));
             m_num_bytes_pods += pod_bytes(val);
+        } else if constexpr (has_fields<T>::value) {
+            visit_fields(val.fields());
         } else {
             val.visit(*this);
         }
     }
 
+    template <typename... Ts>
+    void visit_fields(std::tuple<Ts&...> t) {
+        if constexpr ((is_pod<std::remove_const_t<Ts>>::value && ...)) {
+            if (fields_are_adjacent(t)) {
+                m_br.read(&std::get<0>(t), (sizeof(Ts) + ...));
+                m_num_bytes_pods += (sizeof(Ts) + ...);
+                return;
+            }
+        }
+        std::apply([&](auto&... f) { (visit(f), ...); }, t);
+    }
+
     template <typename T, typename Allocator>
     void visit(std::vector<T, Allocator>& vec) {
+        static_assert(!std::is_same<T, bool>::value,
+                      "store packed uint64_t words plus a bit count instead of vector<bool>");
         size_t n;
         visit(n);
         vec.resize(n);
         if constexpr (is_pod<T>::value) {
-            m_is.read(reinterpret_cast<char*>(vec.data()),
-                      static_cast<std::streamsize>(sizeof(T) * n));
+            m_br.read(vec.data(), sizeof(T) * n);
             m_num_bytes_vecs_of_pods += n * sizeof(T);
         } else {
             for (auto& v : vec) visit(v);
@@ -312,7 +671,7 @@ struct generic_loader {
     }
 
     size_t bytes() {
-        return m_is.tellg();
+        return m_br.consumed();
     }
 
     size_t bytes_pods() {
@@ -326,31 +685,218 @@ struct generic_loader {
 private:
     size_t m_num_bytes_pods;
     size_t m_num_bytes_vecs_of_pods;
-    std::istream& m_is;
+    buffered_reader& m_br;
 };
 
 struct loader : generic_loader {
     loader(char const* filename)
-        : generic_loader(m_is)
-        , m_is(filename, std::ios::binary) {
-        if (!m_is.good()) {
+        : generic_loader(m_br)
+        , m_br(filename) {}
+
+private:
+    buffered_reader m_br;
+};
+
+/* Loader that defers the large POD-vector payloads: the structural walk
+   only reads scalar fields and vector sizes (skipping payload bytes with
+   lseek) while recording {destination, file offset, length} tasks, which
+   are then filled concurrently with pread(2) from a small thread pool.
+   On multi-queue SSDs this turns the payload phase from one sequential
+   stream into parallel reads. The on-disk format is unchanged: vector
+   sizes are stored inline, so no offset table is needed in the file. */
+struct parallel_loader {
+    parallel_loader(char const* filename)
+        : m_br(filename) {}
+
+    template <typename T>
+    void visit(T& val) {
+        if constexpr (is_pod<T>::value) {
+            m_br.read(&val, sizeof(T));
+        } else {
+            val.visit(*this);
+        }
+    }
+
+    template <typename T, typename Allocator>
+    void visit(std::vector<T, Allocator>& vec) {
+        size_t n;
+        visit(n);
+        vec.resize(n);
+        if constexpr (is_pod<T>::value) {
+            m_tasks.push_back({vec.data(), m_br.consumed(), n * sizeof(T)});
+            m_br.skip(n * sizeof(T));
+        } else {
+            for (auto& v : vec) visit(v);
+        }
+    }
+
+    /* fill all recorded payloads; must be called once after visit().
+       Throws std::runtime_error on a failed or short pread (e.g. a
+       truncated input file), like the other loaders. */
+    void fill(size_t num_threads = std::thread::hardware_concurrency()) {
+        if (m_tasks.empty()) return;
+        if (num_threads == 0) num_threads = 1;
+        num_threads = std::min(num_threads, m_tasks.size());
+        std::atomic<size_t> next(0);
+        /* an exception escaping a std::thread body calls std::terminate,
+           and throwing on this thread while the pool is still joinable
+           does the same via ~thread: workers instead record the first
+           error and drain out, every thread is joined unconditionally,
+           and the error is rethrown here once the pool is gone */
+        std::atomic<bool> failed(false);
+        std::exception_ptr error;
+        auto worker = [&]() {
+            try {
+                for (size_t i = next.fetch_add(1); i < m_tasks.size(); i = next.fetch_add(1)) {
+                    if (failed.load()) return;
+                    task const& t = m_tasks[i];
+                    uint8_t* dst = reinterpret_cast<uint8_t*>(t.dst);
+                    size_t offset = t.offset;
+                    size_t left = t.bytes;
+                    while (left > 0) {
+                        ssize_t got = ::pread(m_br.fd(), dst, left, offset);
+                        if (got <= 0) throw std::runtime_error("pread failed");
+                        dst += got;
+                        offset += got;
+                        left -= static_cast<size_t>(got);
+                    }
+                }
+            } catch (...) {
+                // only the exchange winner stores; join() publishes it below
+                if (!failed.exchange(true)) error = std::current_exception();
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t != num_threads - 1; ++t) threads.emplace_back(worker);
+        worker();
+        for (auto& t : threads) t.join();
+        if (error) std::rethrow_exception(error);
+    }
+
+    size_t bytes() {
+        return m_br.consumed();
+    }
+
+private:
+    struct task {
+        void* dst;
+        size_t offset;
+        size_t bytes;
+    };
+
+    buffered_reader m_br;
+    std::vector<task> m_tasks;
+};
+
+template <typename T>
+static size_t load_parallel(T& data_structure, char const* filename,
+                            size_t num_threads = std::thread::hardware_concurrency()) {
+    parallel_loader l(filename);
+    l.visit(data_structure);
+    l.fill(num_threads);
+    return l.bytes();
+}
+
+/* Counterpart of buffered_reader for the save path: small writes are
+   coalesced in a user buffer, large POD-vector payloads bypass it with
+   chunked write(2) calls, and pages of large payloads are dropped from
+   the page cache with POSIX_FADV_DONTNEED once written. */
+struct buffered_writer {
+    static const size_t buffer_size = 65536;
+    static const size_t chunk_size = size_t(4) << 20;
+    static const size_t dontneed_threshold = size_t(1) << 20;
+
+    buffered_writer(char const* filename)
+        : m_buf(std::make_unique<uint8_t[]>(buffer_size))
+        , m_pos(0)
+        , m_flushed(0) {
+        m_fd = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (m_fd == -1) {
             throw std::runtime_error(
                 "Error in opening binary "
                 "file.");
         }
     }
 
+    ~buffered_writer() {
+        if (m_fd != -1) {
+            /* best-effort, as in std::ofstream: the destructor is noexcept,
+               so a failed write here must not escape and terminate. Callers
+               that need the error (the save path) call flush() explicitly. */
+            try {
+                flush();
+            } catch (...) {}
+            ::close(m_fd);
+        }
+    }
+
+    buffered_writer(buffered_writer const&) = delete;
+    buffered_writer& operator=(buffered_writer const&) = delete;
+
+    void write(void const* src, size_t n) {
+        if (n >= buffer_size) {
+            flush();
+            write_raw(src, n);
+            return;
+        }
+        if (m_pos + n > buffer_size) flush();
+        memcpy(m_buf.get() + m_pos, src, n);
+        m_pos += n;
+    }
+
+    void write_raw(void const* src, size_t n) {
+        uint8_t const* in = reinterpret_cast<uint8_t const*>(src);
+        size_t offset = m_flushed;
+        size_t left = n;
+        while (left > 0) {
+            size_t len = std::min(left, chunk_size);
+            ssize_t put = ::write(m_fd, in, len);
+            if (put <= 0) throw std::runtime_error("write failed");
+            in += put;
+            m_flushed += put;
+            left -= static_cast<size_t>(put);
+        }
+#ifdef POSIX_FADV_DONTNEED
+        // do not let multi-MiB table payloads evict hotter page-cache data
+        if (n >= dontneed_threshold) ::posix_fadvise(m_fd, offset, n, POSIX_FADV_DONTNEED);
+#else
+        (void)offset;
+#endif
+    }
+
+    void flush() {
+        if (m_pos == 0) return;
+        size_t n = m_pos;
+        m_pos = 0;
+        uint8_t const* in = m_buf.get();
+        while (n > 0) {
+            ssize_t put = ::write(m_fd, in, n);
+            if (put <= 0) throw std::runtime_error("write failed");
+            in += put;
+            m_flushed += put;
+            n -= static_cast<size_t>(put);
+        }
+    }
+
+    size_t consumed() const {
+        return m_flushed + m_pos;
+    }
+
 private:
-    std::ifstream m_is;
+    int m_fd;
+    std::unique_ptr<uint8_t[]> m_buf;
+    size_t m_pos;
+    size_t m_flushed;
 };
 
 struct generic_saver {
-    generic_saver(std::ostream& os)
-        : m_os(os) {}
+    generic_saver(buffered_writer& bw)
+        : m_bw(bw) {}
 
     template <typename T>
-    void visit(T const& val) {
+    inline void visit(T const& val) {
         if constexpr (is_pod<T>::value) {
+#if PTHASH_ENABLE_INSTRUMENTATION
             PTHASH_LOG_VARS(const char* pod_prefix = "[P3.SAVE.POD]");
             if constexpr (std::is_fundamental<T>::value) {
                 PTHASH_LOG_VARS(pod_prefix = "[P3.SAVE.FUNDAMENTAL]");
@@ -358,7 +904,7 @@ struct generic_saver {
                 PTHASH_LOG_VARS(pod_prefix = "[P3.SAVE.U128]");
             }
 
-            PTHASH_LOG_VARS(size_t initial_offset = m_os.tellp());
+            PTHASH_LOG_VARS(size_t initial_offset = m_bw.consumed());
             PTHASH_LOG_VARS(uint64_t high_part = 0; uint64_t low_part = 0); // Initialize
             PTHASH_LOG_VARS(std::string value_str = "(value not logged)");
 
@@ -378,11 +924,13 @@ struct generic_saver {
                 PTHASH_LOG("%s.BEFORE Name: %s, Type: %s, Size: %lu, Offset: %zu\n",
                         pod_prefix, "POD_VALUE", typeid(T).name(), sizeof(T), initial_offset);
             }
+#endif
 
             // THE ACTUAL WRITE
-            save_pod(m_os, val); // Assumed to handle endianness correctly
+            m_bw.write(&val, sizeof(T));
 
-            PTHASH_LOG_VARS(size_t final_offset = m_os.tellp());
+#if PTHASH_ENABLE_INSTRUMENTATION
+            PTHASH_LOG_VARS(size_t final_offset = m_bw.consumed());
             PTHASH_LOG_VARS(size_t bytes_written = final_offset - initial_offset);
 
             // Determine actual write order if possible (requires knowing save_pod/endianness)
@@ -395,37 +943,56 @@ struct generic_saver {
 
             PTHASH_LOG("%s.AFTER Name: %s, BytesWritten: %zu, FinalOffset: %zu%s\n",
                     pod_prefix, "POD_VALUE", bytes_written, final_offset, order_note.c_str());
+#endif
 
+        } else if constexpr (has_fields<T const>::value) {
+            visit_fields(val.fields());
         } else {
             val.visit(*this);
         }
     }
 
+    template <typename... Ts>
+    void visit_fields(std::tuple<Ts&...> t) {
+        if constexpr ((is_pod<std::remove_const_t<Ts>>::value && ...)) {
+            if (fields_are_adjacent(t)) {
+                m_bw.write(&std::get<0>(t), (sizeof(Ts) + ...));
+                return;
+            }
+        }
+        std::apply([&](auto&... f) { (visit(f), ...); }, t);
+    }
+
     template <typename T, typename Allocator>
     void visit(std::vector<T, Allocator> const& vec) {
+        static_assert(!std::is_same<T, bool>::value,
+                      "store packed uint64_t words plus a bit count instead of vector<bool>");
         if constexpr (is_pod<T>::value) {
             size_t n = vec.size();
 
+#if PTHASH_ENABLE_INSTRUMENTATION
             // --- Log writing the size (n) ---
             PTHASH_LOG_VARS(const char* size_prefix = "[P3.SAVE.VEC_SIZE]");
-            PTHASH_LOG_VARS(size_t initial_offset_size = m_os.tellp());
+            PTHASH_LOG_VARS(size_t initial_offset_size = m_bw.consumed());
             PTHASH_LOG("%s.BEFORE Name: %s, Type: %s, Size: %lu, Offset: %zu, Value: %lu\n",
                     size_prefix, "vector_size", typeid(size_t).name(), sizeof(size_t), initial_offset_size, (unsigned long)n);
+#endif
 
             visit(n); // This recursively calls visit for size_t, which will log itself
 
-            PTHASH_LOG_VARS(size_t final_offset_size = m_os.tellp());
+#if PTHASH_ENABLE_INSTRUMENTATION
+            PTHASH_LOG_VARS(size_t final_offset_size = m_bw.consumed());
             PTHASH_LOG_VARS(size_t bytes_written_size = final_offset_size - initial_offset_size);
             PTHASH_LOG("%s.AFTER Name: %s, BytesWritten: %zu, FinalOffset: %zu\n",
                     size_prefix, "vector_size", bytes_written_size, final_offset_size);
             // --- End log writing the size ---
-
+#endif
 
             // --- Log writing the data ---
             if (n > 0) { // Only log data write if there's data
+#if PTHASH_ENABLE_INSTRUMENTATION
                PTHASH_LOG_VAR(const char*, data_prefix, "[P3.SAVE.VEC_DATA]");
-               PTHASH_LOG_VAR(size_t, initial_offset_data, m_os.tellp());
-               size_t data_bytes_to_write = sizeof(T) * n; // This is needed for actual operations
+               PTHASH_LOG_VAR(size_t, initial_offset_data, m_bw.consumed());
 
                // Preview (optional, adjust as needed)
                PTHASH_LOG_VAR(std::string, preview, "");
@@ -436,25 +1003,22 @@ struct generic_saver {
                }
 
                PTHASH_LOG("%s.BEFORE Name: %s, ElementType: %s, Count: %lu, ElementSize: %lu, TotalBytes: %lu, Offset: %zu%s\n",
-                       data_prefix, "vector_data", typeid(T).name(), (unsigned long)n, sizeof(T), data_bytes_to_write, initial_offset_data, preview.c_str());
+                       data_prefix, "vector_data", typeid(T).name(), (unsigned long)n, sizeof(T), sizeof(T) * n, initial_offset_data, preview.c_str());
+#endif
 
-               m_os.write(reinterpret_cast<char const*>(vec.data()), static_cast<std::streamsize>(data_bytes_to_write));
+               m_bw.write(vec.data(), sizeof(T) * n);
 
-               PTHASH_LOG_VAR(size_t, final_offset_data, m_os.tellp());
+#if PTHASH_ENABLE_INSTRUMENTATION
+               PTHASH_LOG_VAR(size_t, final_offset_data, m_bw.consumed());
                PTHASH_LOG_VAR(size_t, bytes_written_data, final_offset_data - initial_offset_data);
-               
-               // Only check for errors in the logging stream if we're actually logging
-               #if PTHASH_ENABLE_INSTRUMENTATION
-                if (!m_os) {
-                     PTHASH_LOG("%s.ERROR Error occurred during vector data write!\n", data_prefix);
-                     // Consider throwing or handling the error appropriately
-                } else if (bytes_written_data != data_bytes_to_write) {
-                     PTHASH_LOG("%s.WARN Wrote %zu bytes but expected %zu bytes!\n", data_prefix, bytes_written_data, data_bytes_to_write);
-                }
-               #endif
-               
+
+               if (bytes_written_data != sizeof(T) * n) {
+                     PTHASH_LOG("%s.WARN Wrote %zu bytes but expected %zu bytes!\n", data_prefix, bytes_written_data, sizeof(T) * n);
+               }
+
                PTHASH_LOG("%s.AFTER Name: %s, BytesWritten: %zu, FinalOffset: %zu\n",
                        data_prefix, "vector_data", bytes_written_data, final_offset_data);
+#endif
             }
             // --- End log writing the data ---
 
@@ -466,26 +1030,24 @@ struct generic_saver {
     }
 
     size_t bytes() {
-        return m_os.tellp();
+        /* called once the walk is done: drain the buffer here so a failed
+           write (e.g. disk full) surfaces as an exception to the caller of
+           save(), instead of being swallowed by the best-effort destructor */
+        m_bw.flush();
+        return m_bw.consumed();
     }
 
 private:
-    std::ostream& m_os;
+    buffered_writer& m_bw;
 };
 
 struct saver : generic_saver {
     saver(char const* filename)
-        : generic_saver(m_os)
-        , m_os(filename, std::ios::binary) {
-        if (!m_os.good()) {
-            throw std::runtime_error(
-                "Error in opening binary "
-                "file.");
-        }
-    }
+        : generic_saver(m_bw)
+        , m_bw(filename) {}
 
 private:
-    std::ofstream m_os;
+    buffered_writer m_bw;
 };
 
 [[maybe_unused]] static std::string demangle(char const* mangled_name) {
@@ -496,29 +1058,27 @@ private:
     return ptr.get();
 }
 
-struct sizer {
-    sizer(std::string const& root_name = "")
-        : m_root(0, 0, root_name)
-        , m_current(&m_root) {}
-
-    struct node {
-        node(size_t b, size_t d, std::string const& n = "")
-            : bytes(b)
-            , depth(d)
-            , name(n) {}
+/* __cxa_demangle mallocs on every call; cache the result per type so
+   recursive size computations demangle each type once per process */
+template <typename T>
+static std::string const& demangled_name() {
+    static const std::string name = demangle(typeid(T).name());
+    return name;
+}
 
-        size_t bytes;
-        size_t depth;
-        std::string name;
-        std::vector<node> children;
-    };
+/* The size tree is kept in structure-of-arrays form, indexed by node
+   id: traversal and accumulation touch only the bytes/depth columns,
+   and growing the tree never invalidates the current-node handle. */
+struct sizer {
+    sizer(std::string const& root_name = "") {
+        new_node(0, 0, root_name);
+        m_current = 0;
+    }
 
     template <typename T>
     void visit(T& val) {
         if constexpr (is_pod<T>::value) {
-            node n(pod_bytes(val), m_current->depth + 1, demangle(typeid(T).name()));
-            m_current->children.push_back(n);
-            m_current->bytes += n.bytes;
+            add_child(pod_bytes(val), demangled_name<T>());
         } else {
             val.visit(*this);
         }
@@ -527,30 +1087,28 @@ struct sizer {
     template <typename T, typename Allocator>
     void visit(std::vector<T, Allocator>& vec) {
         if constexpr (is_pod<T>::value) {
-            node n(vec_bytes(vec), m_current->depth + 1, demangle(typeid(std::vector<T>).name()));
-            m_current->children.push_back(n);
-            m_current->bytes += n.bytes;
+            add_child(vec_bytes(vec), demangled_name<std::vector<T>>());
         } else {
             size_t n = vec.size();
-            m_current->bytes += pod_bytes(n);
-            node* parent = m_current;
+            m_bytes[m_current] += pod_bytes(n);
+            uint32_t parent = m_current;
             for (auto& v : vec) {
-                node n(0, parent->depth + 1, demangle(typeid(T).name()));
-                parent->children.push_back(n);
-                m_current = &parent->children.back();
+                m_current = parent;
+                uint32_t child = add_child(0, demangled_name<T>());
+                m_current = child;
                 visit(v);
-                parent->bytes += m_current->bytes;
+                m_bytes[parent] += m_bytes[child];
             }
             m_current = parent;
         }
     }
 
     template <typename Device>
-    void print(node const& n, size_t total_bytes, Device& device) const {
-        auto indent = std::string(n.depth * 4, ' ');
-        device << indent << "'" << n.name << "' - bytes = " << n.bytes << " ("
-               << n.bytes * 100.0 / total_bytes << "%)" << std::endl;
-        for (auto const& child : n.children) {
+    void print(uint32_t id, size_t total_bytes, Device& device) const {
+        auto indent = std::string(m_depth[id] * 4, ' ');
+        device << indent << "'" << m_name[id] << "' - bytes = " << m_bytes[id] << " ("
+               << m_bytes[id] * 100.0 / total_bytes << "%)" << std::endl;
+        for (uint32_t child : m_children[id]) {
             device << indent;
             print(child, total_bytes, device);
         }
@@ -558,16 +1116,35 @@ struct sizer {
 
     template <typename Device>
     void print(Device& device) const {
-        print(m_root, bytes(), device);
+        print(0, bytes(), device);
     }
 
     size_t bytes() const {
-        return m_root.bytes;
+        return m_bytes[0];
     }
 
 private:
-    node m_root;
-    node* m_current;
+    std::vector<size_t> m_bytes;
+    std::vector<size_t> m_depth;
+    std::vector<std::string> m_name;
+    std::vector<std::vector<uint32_t>> m_children;
+    uint32_t m_current;
+
+    uint32_t new_node(size_t bytes, size_t depth, std::string const& name) {
+        uint32_t id = static_cast<uint32_t>(m_bytes.size());
+        m_bytes.push_back(bytes);
+        m_depth.push_back(depth);
+        m_name.push_back(name);
+        m_children.emplace_back();
+        return id;
+    }
+
+    uint32_t add_child(size_t bytes, std::string const& name) {
+        uint32_t id = new_node(bytes, m_depth[m_current] + 1, name);
+        m_children[m_current].push_back(id);
+        m_bytes[m_current] += bytes;
+        return id;
+    }
 };
 
 template <typename T>
@@ -589,6 +1166,18 @@ struct allocator : std::allocator<T> {
         if (m_addr == nullptr) return std::allocator<T>::deallocate(p, n);
     }
 
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        // do not touch pre-existing storage: the bytes at m_addr are already
+        // the element payload (arena or memory-mapped file)
+        if (m_addr == nullptr) ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    void destroy(U* p) {
+        if (m_addr == nullptr) p->~U();
+    }
+
 private:
     T* m_addr;
 };
@@ -672,21 +1261,122 @@ struct contiguous_memory_allocator {
         std::ifstream m_is;
     };
 
+    /* Walks a memory-mapped serialized file: POD fields and POD-vector
+       payloads are copied out of the mapping with pointer-bump reads.
+       The vectors cannot adopt the mapped bytes directly: their declared
+       allocator is std::allocator, so the essentials::allocator hook
+       gets sliced away by the vector constructor (see visit below).
+       The visitor owns the mapping and unmaps it on destruction, on the
+       success and the error path alike. */
+    struct mmap_visitor {
+        mmap_visitor(char const* filename)
+            : m_begin(nullptr)
+            , m_size(0)
+            , m_cursor(nullptr) {
+            int fd = ::open(filename, O_RDONLY);
+            if (fd == -1) {
+                throw std::runtime_error(
+                    "Error in opening binary "
+                    "file.");
+            }
+            struct stat st;
+            if (::fstat(fd, &st) == -1) {
+                ::close(fd);
+                throw std::runtime_error("fstat failed");
+            }
+            m_size = static_cast<size_t>(st.st_size);
+            int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+            flags |= MAP_POPULATE;
+#endif
+            void* addr = ::mmap(nullptr, m_size, PROT_READ, flags, fd, 0);
+            ::close(fd);  // the mapping keeps its own reference
+            if (addr == MAP_FAILED) throw std::runtime_error("mmap failed");
+            m_begin = reinterpret_cast<uint8_t*>(addr);
+#ifdef MADV_WILLNEED
+            ::madvise(m_begin, m_size, MADV_WILLNEED);
+            ::madvise(m_begin, m_size, MADV_SEQUENTIAL);
+#endif
+            m_cursor = m_begin;
+        }
+
+        ~mmap_visitor() {
+            if (m_begin != nullptr) ::munmap(m_begin, m_size);
+        }
+
+        mmap_visitor(mmap_visitor const&) = delete;
+        mmap_visitor& operator=(mmap_visitor const&) = delete;
+
+        template <typename T>
+        void visit(T& val) {
+            if constexpr (is_pod<T>::value) {
+                read_pod(val);
+            } else {
+                val.visit(*this);
+            }
+        }
+
+        template <typename T, typename Allocator>
+        void visit(std::vector<T, Allocator>& vec) {
+            size_t n;
+            read_pod(n);
+            if constexpr (is_pod<T>::value) {
+                /* The vector cannot sit on top of the mapping: its
+                   declared Allocator is std::allocator<T>, so handing it
+                   an essentials::allocator<T> slices the mapped address
+                   away and resize() silently re-allocates zeros on the
+                   heap. Copy the payload out instead - one bulk memcpy
+                   per vector over the populated mapping. */
+                consume(n * sizeof(T));
+                vec.resize(n);
+                if (n != 0) memcpy(vec.data(), m_cursor - n * sizeof(T), n * sizeof(T));
+            } else {
+                vec.resize(n);
+                for (auto& v : vec) visit(v);
+            }
+        }
+
+        size_t size() const {
+            return m_size;
+        }
+
+        size_t allocated() const {
+            assert(m_cursor >= m_begin);
+            return m_cursor - m_begin;
+        }
+
+        void consume(size_t num_bytes) {
+            if (allocated() + num_bytes > size()) {
+                throw std::runtime_error("allocation failed");
+            }
+            m_cursor += num_bytes;
+        }
+
+    private:
+        uint8_t* m_begin;
+        size_t m_size;
+        uint8_t* m_cursor;
+
+        template <typename T>
+        void read_pod(T& val) {
+            consume(sizeof(T));
+            memcpy(&val, m_cursor - sizeof(T), sizeof(T));
+        }
+    };
+
     template <typename T>
     size_t allocate(T& data_structure, char const* filename) {
-        loader l(filename);
-        l.visit(data_structure);
-        m_size = l.bytes_vecs_of_pods();
-        m_begin = reinterpret_cast<uint8_t*>(malloc(m_size));
-        if (m_begin == nullptr) throw std::runtime_error("malloc failed");
-        visitor v(m_begin, m_size, filename);
+        mmap_visitor v(filename);
         v.visit(data_structure);
-        m_end = v.end();
-        return l.bytes();
+        /* the payloads are copied out of the mapping during the walk
+           (see mmap_visitor::visit), so nothing points into it once the
+           visit returns; v unmaps it on scope exit, also when visit
+           throws on a malformed file */
+        return v.allocated();
     }
 
     ~contiguous_memory_allocator() {
-        free(m_begin);
+        release();
     }
 
     uint8_t* begin() {
@@ -705,6 +1395,13 @@ private:
     uint8_t* m_begin;
     uint8_t* m_end;
     size_t m_size;
+
+    void release() {
+        if (m_begin != nullptr) ::munmap(m_begin, m_size);
+        m_begin = nullptr;
+        m_end = nullptr;
+        m_size = 0;
+    }
 };
 
 template <typename Visitor, typename T>
@@ -759,6 +1456,17 @@ struct directory {
         if (m_n < 0) {
             throw std::runtime_error("error during scandir");
         }
+        /* parse every entry once here, so that iteration is a plain
+           indexed walk with no per-dereference allocations */
+        m_files.reserve(m_n);
+        for (int i = 0; i != m_n; ++i) {
+            file_name fn;
+            fn.name = m_items_names[i]->d_name;
+            fn.fullpath = m_name + "/" + fn.name;
+            size_t p = fn.name.find_last_of(".");
+            fn.extension = fn.name.substr(p + 1);
+            m_files.push_back(std::move(fn));
+        }
     }
 
     std::string const& name() const {
@@ -774,13 +1482,8 @@ struct directory {
             : m_d(d)
             , m_i(i) {}
 
-        file_name operator*() {
-            file_name fn;
-            fn.name = m_d->m_items_names[m_i]->d_name;
-            fn.fullpath = m_d->name() + "/" + fn.name;
-            size_t p = fn.name.find_last_of(".");
-            fn.extension = fn.name.substr(p + 1);
-            return fn;
+        file_name const& operator*() {
+            return m_d->m_files[m_i];
         }
 
         void operator++() {
@@ -812,6 +1515,7 @@ private:
     std::string m_name;
     struct dirent** m_items_names;
     int m_n;
+    std::vector<file_name> m_files;
 };
 #endif
 
@@ -121,6 +121,38 @@ struct bit_vector  //
             return word;
         }
 
+        /*
+            Sequential one-setter over increasing positions: ones accumulate
+            into a register and each data word is stored exactly once, when
+            the write position moves past it, instead of paying a
+            read-modify-write per bit. Assumes the builder words are still
+            zero (fresh construction) and that all ones go through this
+            writer; call flush() before build().
+        */
+        struct one_stream {
+            one_stream(builder* b) : m_b(b), m_word_idx(0), m_word(0) {}
+
+            [[gnu::always_inline]] inline void set(uint64_t pos) {
+                assert(pos < m_b->num_bits());
+                uint64_t idx = pos >> 6;
+                if (idx != m_word_idx) {
+                    m_b->m_data[m_word_idx] = m_word;
+                    m_word = 0;
+                    m_word_idx = idx;
+                }
+                m_word |= uint64_t(1) << (pos & 63);
+            }
+
+            void flush() {
+                if (m_word) m_b->m_data[m_word_idx] = m_word;
+            }
+
+        private:
+            builder* m_b;
+            uint64_t m_word_idx;
+            uint64_t m_word;
+        };
+
         void append(builder const& rhs) {
             if (!rhs.num_bits()) return;
 
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <vector>
-#include <cmath>
+#include <array>
 #include <iterator>
+#include <utility>
+#include <cstring>
 #include <cstdio> // For fprintf
 
 #include "essentials.hpp"
@@ -11,6 +13,30 @@
 
 namespace bits {
 
+namespace detail {
+
+/* per-width extraction for compact_vector: same padded 16-byte load as the
+   generic form, but bit position and mask are compile-time constants */
+template <uint64_t W>
+uint64_t cv_get(uint64_t const* data, uint64_t i) {
+    constexpr uint64_t mask = (W == 64) ? uint64_t(-1) : ((uint64_t(1) << W) - 1);
+    uint64_t bpos = i * W;
+    uint8_t const* p = reinterpret_cast<uint8_t const*>(data) + (bpos >> 3);
+    __uint128_t word;
+    memcpy(&word, p, 16);
+    return static_cast<uint64_t>(word >> (bpos & 7)) & mask;
+}
+
+using cv_get_fn = uint64_t (*)(uint64_t const*, uint64_t);
+
+template <uint64_t... W>
+constexpr std::array<cv_get_fn, sizeof...(W)> make_cv_get_table(
+    std::integer_sequence<uint64_t, W...>) {
+    return {cv_get<W>...};
+}
+
+}  // namespace detail
+
 struct compact_vector  //
 {
     template <typename Vec>
@@ -66,7 +92,7 @@ struct compact_vector  //
         int64_t m_cur_shift;
         Vec const* m_vec;
 
-        void read() {
+        [[gnu::always_inline]] inline void read() {
             if (m_cur_shift + m_vec->m_width <= 64) {
                 m_cur_val = m_vec->m_data[m_cur_block] >> m_cur_shift & m_vec->m_mask;
             } else {
@@ -87,7 +113,7 @@ struct compact_vector  //
     };
 
     struct builder {
-        builder() : m_size(0), m_width(0), m_mask(0), m_back(0), m_cur_block(0), m_cur_shift(0) {}
+        builder() : m_size(0), m_width(0), m_mask(0), m_cur_block(0), m_cur_shift(0) {}
 
         builder(uint64_t n, uint64_t w) { resize(n, w); }
 
@@ -98,10 +124,10 @@ struct compact_vector  //
             m_size = n;
             m_width = w;
             m_mask = -(w == 64) | ((uint64_t(1) << w) - 1);
-            m_back = 0;
             m_data.resize(
-                /* use 1 word more for safe access() */
-                essentials::words_for(m_size * m_width) + 1, 0);
+                /* two extra words so the unaligned 16-byte load in
+                   operator[] stays in bounds for every position */
+                essentials::words_for(m_size * m_width) + 2, 0);
         }
 
         template <typename Iterator>
@@ -112,31 +138,80 @@ struct compact_vector  //
         template <typename Iterator>
         void fill(Iterator begin, uint64_t n) {
             if (m_width == 0) throw std::runtime_error("width must be > 0");
+#if defined(__x86_64__)
+            /*
+                Large fills write m_data once and do not read it back until
+                query time, so caching the stores only evicts useful lines.
+                Above half an L2's worth of packed data, pack into an
+                accumulator and spill complete words with non-temporal
+                stores instead of going through set().
+            */
+            if (essentials::words_for(n * m_width) >= m_nt_store_threshold_words) {
+                fill_stream(begin, n);
+                return;
+            }
+#endif
             for (uint64_t i = 0; i != n; ++i, ++begin) set(i, *begin);
         }
 
+#if defined(__x86_64__)
+        template <typename Iterator>
+        void fill_stream(Iterator begin, uint64_t n) {
+            uint64_t out_word = 0;
+            uint64_t out_reg = 0;
+            uint64_t out_bits = 0;
+            for (uint64_t i = 0; i != n; ++i, ++begin) {
+                uint64_t v = *begin;
+                out_reg |= v << out_bits;
+                out_bits += m_width;
+                if (out_bits >= 64) {
+                    _mm_stream_si64(reinterpret_cast<long long*>(m_data.data() + out_word),
+                                    (long long)out_reg);
+                    ++out_word;
+                    out_bits -= 64;
+                    // ">> (m_width - out_bits)" without UB at out_bits == 0, m_width == 64
+                    out_reg = v >> 1 >> (m_width - out_bits - 1);
+                }
+            }
+            if (out_bits) m_data[out_word] = out_reg;  // partial tail: temporal store is fine
+            _mm_sfence();
+        }
+#endif
+
         /*
             Set value v at position i.
+
+            Branchless double-store: both words covering the element are
+            rewritten unconditionally. When the element does not straddle a
+            word boundary the second store carries an all-zero mask and is a
+            no-op; the double right shift (>> 1 >> (63 - shift)) realizes
+            ">> (64 - shift)" without undefined behaviour at shift == 0.
+            The two padding words appended by resize() keep m_data[block + 1]
+            in bounds for the last element.
         */
-        void set(uint64_t i, uint64_t v) {
+        [[gnu::always_inline]] inline void set(uint64_t i, uint64_t v) {
             assert(m_width != 0);
             assert(i < m_size);
-            if (i == m_size - 1) m_back = v;
 
             uint64_t pos = i * m_width;
             uint64_t block = pos >> 6;
             uint64_t shift = pos & 63;
 
-            m_data[block] &= ~(m_mask << shift);
-            m_data[block] |= v << shift;
-
-            uint64_t res_shift = 64 - shift;
-            if (res_shift < m_width) {
-                m_data[block + 1] &= ~(m_mask >> res_shift);
-                m_data[block + 1] |= v >> res_shift;
-            }
+            uint64_t high_mask = m_mask >> 1 >> (63 - shift);
+            uint64_t high_bits = v >> 1 >> (63 - shift);
+            m_data[block] = (m_data[block] & ~(m_mask << shift)) | (v << shift);
+            m_data[block + 1] = (m_data[block + 1] & ~high_mask) | high_bits;
         }
 
+        /*
+            Streaming in-place repack: elements are decoded left-to-right and
+            packed into a 64-bit accumulator that spills one full word at a
+            time. Because the new width is strictly smaller, the output word
+            index always trails the input read position, so no element is
+            clobbered before it is read. This replaces the old per-element
+            set() rewrite, which interleaved reads and conditional writes in
+            the same words.
+        */
         void reduce_width_by(uint64_t n) {
             assert(m_width > n);
 
@@ -145,22 +220,67 @@ struct compact_vector  //
             m_width -= n;
             m_mask = -(m_width == 64) | ((uint64_t(1) << m_width) - 1);
 
-            for (uint64_t i = 0, pos = 0; i < m_size; ++i, pos += old_width) {
-                // Note: this loop could be optimized,
-                // because we access consecutive elements
+            uint64_t out_word = 0;
+            uint64_t out_reg = 0;
+            uint64_t out_bits = 0;
+            for (uint64_t i = 0, pos = 0; i != m_size; ++i, pos += old_width) {
                 uint64_t block = pos >> 6;
                 uint64_t shift = pos & 63;
-                uint64_t old_elem =
+                uint64_t elem =
                     shift + old_width <= 64
                         ? m_data[block] >> shift & old_mask
                         : (m_data[block] >> shift) | (m_data[block + 1] << (64 - shift) & old_mask);
-                uint64_t new_elem = old_elem & m_mask;
-                set(i, new_elem);
+                elem &= m_mask;
+                out_reg |= elem << out_bits;
+                out_bits += m_width;
+                if (out_bits >= 64) {
+                    m_data[out_word++] = out_reg;
+                    out_bits -= 64;
+                    out_reg = elem >> (m_width - out_bits);  // m_width < 64, shift is defined
+                }
             }
+            if (out_bits) m_data[out_word++] = out_reg;
 
-            m_data.resize(essentials::words_for(m_size * m_width) + 1, 0);
+            m_data.resize(essentials::words_for(m_size * m_width) + 2, 0);
+            // clear the residue of the old packing in the tail + padding words
+            std::fill(m_data.begin() + out_word, m_data.end(), 0);
         }
 
+        /*
+            Sequential appender: packs values left-to-right like fill_stream,
+            with one plain word store per 64 accumulated bits instead of the
+            branchless double-store rewrite of set(). For callers producing
+            one element at a time (so fill() does not apply); push exactly
+            the number of elements the builder was sized for, then flush().
+        */
+        struct stream {
+            stream(builder* b)
+                : m_b(b), m_width(b->m_width), m_out_word(0), m_out_reg(0), m_out_bits(0) {}
+
+            [[gnu::always_inline]] inline void push(uint64_t v) {
+                assert((v & ~m_b->m_mask) == 0);
+                m_out_reg |= v << m_out_bits;
+                m_out_bits += m_width;
+                if (m_out_bits >= 64) {
+                    m_b->m_data[m_out_word++] = m_out_reg;
+                    m_out_bits -= 64;
+                    // ">> (m_width - m_out_bits)" without UB, as in fill_stream
+                    m_out_reg = v >> 1 >> (m_width - m_out_bits - 1);
+                }
+            }
+
+            void flush() {
+                if (m_out_bits) m_b->m_data[m_out_word] = m_out_reg;
+            }
+
+        private:
+            builder* m_b;
+            uint64_t m_width;
+            uint64_t m_out_word;
+            uint64_t m_out_reg;
+            uint64_t m_out_bits;
+        };
+
         friend struct enumerator<builder>;  // to let enumerator access private members
 
         typedef enumerator<builder> iterator;
@@ -179,22 +299,31 @@ struct compact_vector  //
             std::swap(m_size, other.m_size);
             std::swap(m_width, other.m_width);
             std::swap(m_mask, other.m_mask);
-            std::swap(m_back, other.m_back);
             std::swap(m_cur_block, other.m_cur_block);
             std::swap(m_cur_shift, other.m_cur_shift);
             m_data.swap(other.m_data);
         }
 
-        uint64_t back() const { return m_back; }
+        /* computed lazily instead of being tracked by every set() call */
+        uint64_t back() const {
+            assert(m_size > 0);
+            uint64_t bpos = (m_size - 1) * m_width;
+            uint8_t const* p = reinterpret_cast<uint8_t const*>(m_data.data()) + (bpos >> 3);
+            __uint128_t word;
+            memcpy(&word, p, 16);
+            return static_cast<uint64_t>(word >> (bpos & 7)) & m_mask;
+        }
         uint64_t size() const { return m_size; }
         uint64_t width() const { return m_width; }
         std::vector<uint64_t> const& data() const { return m_data; }
 
     private:
+        /* ~half a typical L2 (1 MiB) of packed words */
+        static constexpr uint64_t m_nt_store_threshold_words = (512 * 1024) / sizeof(uint64_t);
+
         uint64_t m_size;
         uint64_t m_width;
         uint64_t m_mask;
-        uint64_t m_back;
         uint64_t m_cur_block;
         int64_t m_cur_shift;
         std::vector<uint64_t> m_data;
@@ -206,7 +335,9 @@ struct compact_vector  //
     void build(Iterator begin, uint64_t n) {
         assert(n > 0);
         uint64_t max = *std::max_element(begin, begin + n);
-        uint64_t width = max == 0 ? 1 : std::ceil(std::log2(max + 1));
+        // bits needed for max: integer count-leading-zeros instead of the
+        // old FP ceil(log2(max + 1)), which rounds wrong near 2^w - 1
+        uint64_t width = max == 0 ? 1 : 64 - __builtin_clzll(max);
         build(begin, n, width);
     }
 
@@ -216,48 +347,65 @@ struct compact_vector  //
         builder.build(*this);
     }
 
-    uint64_t operator[](uint64_t i) const {
+    /*
+        Branchless extraction: load the 16 bytes covering the element at
+        its byte address and funnel-shift by the residual bit offset
+        (0..7). The old two-word form branched on whether the element
+        straddled a word boundary, a data-dependent branch that
+        mispredicts on random queries. The builder pads m_data by two
+        words so the 16-byte load is always in bounds.
+    */
+    [[gnu::always_inline]] inline uint64_t operator[](uint64_t i) const {
         assert(i < size());
-        uint64_t pos = i * m_width;
-        uint64_t block = pos >> 6;
-        uint64_t shift = pos & 63;
-        return shift + m_width <= 64
-                   ? m_data[block] >> shift & m_mask
-                   : (m_data[block] >> shift) | (m_data[block + 1] << (64 - shift) & m_mask);
+        /*
+            m_width is fixed for the lifetime of the vector, so dispatch
+            through a per-width specialization: in each entry the multiply
+            is by a literal (strength-reduced to shifts/leas) and the mask
+            is a folded constant. One predictable indirect call replaces
+            the variable multiply + runtime mask load of the generic form.
+        */
+        static constexpr auto table =
+            detail::make_cv_get_table(std::make_integer_sequence<uint64_t, 65>{});
+        return table[m_width](m_data.data(), i);
     }
 
-    uint64_t access(uint64_t i) const {
-        PTHASH_LOG_VARS(const char* log_prefix = "[P8.CV_ACCESS]");
-        PTHASH_LOG("%s ENTER access(i=%llu)\n", log_prefix, (unsigned long long)i);
-        assert(i < size());
-        uint64_t pos = i * m_width;
-        uint64_t block = pos >> 6;
-        uint64_t shift = pos & 63;
-        PTHASH_LOG("%s   Intermediate: pos=%llu, block=%llu, shift=%llu, m_mask=0x%llX, m_width=%llu\n",
-                log_prefix, (unsigned long long)pos, (unsigned long long)block,
-                (unsigned long long)shift, (unsigned long long)m_mask, (unsigned long long)m_width);
-
-        uint64_t result;
-        if (shift + m_width <= 64) {
-            PTHASH_LOG("%s   Path: Single word read. Reading m_data[%llu] (0x%llX)\n",
-                    log_prefix, (unsigned long long)block, (unsigned long long)m_data[block]);
-            result = m_data[block] >> shift & m_mask;
-        } else {
-            PTHASH_LOG("%s   Path: Multi-word read. Reading m_data[%llu] (0x%llX)",
-                    log_prefix, (unsigned long long)block, (unsigned long long)m_data[block]);
-            // Check bounds before reading the second word
-            if (block + 1 < m_data.size()) {
-                 PTHASH_LOG(" and m_data[%llu] (0x%llX)\n",
-                         (unsigned long long)(block + 1), (unsigned long long)m_data[block + 1]);
-                 result = (m_data[block] >> shift) | (m_data[block + 1] << (64 - shift) & m_mask);
-            } else {
-                 // This case indicates the expected padding might be missing or index is borderline
-                 PTHASH_LOG("\n%s   WARNING: Reading second word at end of data boundary (block+1 >= m_data.size()). Applying mask only to first part.\n", log_prefix);
-                 result = (m_data[block] >> shift) & m_mask; // Only take bits from the first word
+    /* same bit extraction as operator[]: the builder always pads m_data
+       with one extra word, so the second-word read needs no bounds check */
+    [[gnu::always_inline]] inline uint64_t access(uint64_t i) const {
+        return operator[](i);
+    }
+
+    /*
+        Decode the n elements [start, start + n) into out. With AVX2,
+        four elements are decoded per iteration: a byte-granular gather
+        picks up the 8 bytes covering each element, a variable shift
+        drops the residual 0..7 bit offset, and a broadcast mask cuts
+        the value. This needs width <= 56 so that shift + width fits in
+        the gathered 64 bits; wider elements (and the tail) fall back to
+        the scalar operator[].
+    */
+    void decode_range(uint64_t start, uint64_t n, uint64_t* out) const {
+        assert(start + n <= size());
+        uint64_t i = 0;
+#ifdef __AVX2__
+        if (m_width <= 56) {
+            uint8_t const* base = reinterpret_cast<uint8_t const*>(m_data.data());
+            const __m256i mask = _mm256_set1_epi64x(m_mask);
+            for (; i + 4 <= n; i += 4) {
+                uint64_t b0 = (start + i) * m_width;
+                uint64_t b1 = b0 + m_width;
+                uint64_t b2 = b1 + m_width;
+                uint64_t b3 = b2 + m_width;
+                __m256i offsets = _mm256_set_epi64x(b3 >> 3, b2 >> 3, b1 >> 3, b0 >> 3);
+                __m256i words = _mm256_i64gather_epi64(  //
+                    reinterpret_cast<long long const*>(base), offsets, 1);
+                __m256i shifts = _mm256_set_epi64x(b3 & 7, b2 & 7, b1 & 7, b0 & 7);
+                __m256i vals = _mm256_and_si256(_mm256_srlv_epi64(words, shifts), mask);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), vals);
             }
         }
-        PTHASH_LOG("%s EXIT access -> %llu (0x%llX)\n", log_prefix, (unsigned long long)result, (unsigned long long)result);
-        return result;
+#endif
+        for (; i != n; ++i) out[i] = operator[](start + i);
     }
 
     uint64_t back() const { return operator[](size() - 1); }
@@ -298,43 +446,10 @@ private:
 
     template <typename Visitor, typename T>
     static void visit_impl(Visitor& visitor, T&& t) {
-        PTHASH_LOG_VARS(const char* prefix = "[P3.SAVE.CV]");
-
-        // Log m_size
-        PTHASH_LOG_VARS(size_t offset_before_size = visitor.bytes());
-        PTHASH_LOG("%s.BEFORE Name: %s, Type: %s, Size: %lu, Offset: %zu\n",
-                prefix, "m_size", "uint64_t", sizeof(t.m_size), offset_before_size);
-        visitor.visit(t.m_size); // *** ACTUAL CALL ***
-        PTHASH_LOG_VARS(size_t offset_after_size = visitor.bytes());
-        PTHASH_LOG("%s.AFTER Name: %s, BytesWritten: %zu, FinalOffset: %zu\n",
-                prefix, "m_size", offset_after_size - offset_before_size, offset_after_size);
-
-        // Log m_width
-        PTHASH_LOG_VARS(size_t offset_before_width = visitor.bytes());
-        PTHASH_LOG("%s.BEFORE Name: %s, Type: %s, Size: %lu, Offset: %zu\n",
-                prefix, "m_width", "uint64_t", sizeof(t.m_width), offset_before_width);
-        visitor.visit(t.m_width); // *** ACTUAL CALL ***
-        PTHASH_LOG_VARS(size_t offset_after_width = visitor.bytes());
-        PTHASH_LOG("%s.AFTER Name: %s, BytesWritten: %zu, FinalOffset: %zu\n",
-                prefix, "m_width", offset_after_width - offset_before_width, offset_after_width);
-
-        // Log m_mask
-        PTHASH_LOG_VARS(size_t offset_before_mask = visitor.bytes());
-        PTHASH_LOG("%s.BEFORE Name: %s, Type: %s, Size: %lu, Offset: %zu\n",
-                prefix, "m_mask", "uint64_t", sizeof(t.m_mask), offset_before_mask);
-        visitor.visit(t.m_mask); // *** ACTUAL CALL ***
-        PTHASH_LOG_VARS(size_t offset_after_mask = visitor.bytes());
-        PTHASH_LOG("%s.AFTER Name: %s, BytesWritten: %zu, FinalOffset: %zu\n",
-                prefix, "m_mask", offset_after_mask - offset_before_mask, offset_after_mask);
-
-        // Log m_data (vector)
-        PTHASH_LOG_VARS(size_t offset_before_data = visitor.bytes());
-        PTHASH_LOG("%s.BEFORE Name: %s, Type: %s, Offset: %zu\n",
-                prefix, "m_data", "std::vector<uint64_t>", offset_before_data);
-        visitor.visit(t.m_data); // *** ACTUAL CALL *** (Will trigger vector logging)
-        PTHASH_LOG_VARS(size_t offset_after_data = visitor.bytes());
-        PTHASH_LOG("%s.AFTER Name: %s, BytesWritten: %zu, FinalOffset: %zu\n",
-                prefix, "m_data", offset_after_data - offset_before_data, offset_after_data);
+        visitor.visit(t.m_size);
+        visitor.visit(t.m_width);
+        visitor.visit(t.m_mask);
+        visitor.visit(t.m_data);
     }
 };
 
@@ -2,7 +2,10 @@
 
 #include "util.hpp"
 #include "bit_vector.hpp"
+#include "compact_vector.hpp"
 #include <cstdio> // For fprintf, stderr etc.
+#include <algorithm>
+#include <thread>
 
 // Define PTHASH_LOG if not already defined
 #ifndef PTHASH_LOG
@@ -63,6 +66,9 @@ namespace bits {
     L2 = 65,536 (so that each position in a dense block can be coded
                  using 16-bit integers)
     L3 = 32 (subblock_size)
+
+    and stores four position samples per subblock (one every L3/4 = 8
+    ones), so the linear scan of a dense select covers fewer than 8 ones.
 */
 
 template <                       //
@@ -71,201 +77,401 @@ template <                       //
     uint64_t subblock_size = 32  //
     >
 struct darray {
+    /*
+        A block-inventory entry is a plain unsigned value: the bit position
+        of the super-block's first one if the block is dense, or its index
+        into m_overflow_positions if sparse. The dense/sparse flag lives in
+        the side bitmap m_block_is_sparse rather than in a sign bit, so the
+        read side tests a single bit instead of a signed comparison. The
+        entries are bit-packed into a compact_vector at ceil(log2(max))
+        bits each, keeping the primary random-access table of select()
+        several times smaller (hence hotter in cache) than one word per
+        super-block.
+    */
     darray() : m_positions(0) {}
 
     void build(bit_vector const& B) {
         std::vector<uint64_t> const& data = B.data();
-        std::vector<uint64_t> cur_block_positions;
-        std::vector<int64_t> block_inventory;
-        std::vector<uint16_t> subblock_inventory;
-        std::vector<uint64_t> overflow_positions;
 
-        for (uint64_t word_idx = 0; word_idx < data.size(); ++word_idx) {
-            uint64_t cur_pos = word_idx << 6;
-            uint64_t cur_word = WordGetter()(data, word_idx);
-            uint64_t l;
-            while (util::lsbll(cur_word, l)) {
-                cur_pos += l;
-                cur_word >>= l;
-                if (cur_pos >= B.num_bits()) break;
+        /*
+            First pass: popcount the whole sequence to learn the exact number
+            of positions, so that the inventories can be reserved up front and
+            the main loop never reallocates. Bits of the last word beyond
+            num_bits() are padding (the negating getter turns them into ones),
+            hence they are masked out before counting.
+        */
+        uint64_t total_ones = 0;
+        uint64_t word_idx = 0;
+        uint64_t const* d = data.data();
+        /*
+            Only the final word can hold padding, so everything before it is
+            counted with the widest popcount available; the scalar tail
+            masks the last word. Same tiers as the select scan.
+        */
+#if defined(__AVX512VPOPCNTDQ__) && defined(__AVX512F__)
+/* same GCC 12 -Wmaybe-uninitialized false positive as in select() below:
+   _mm512_reduce_add_epi64 expands through _mm512_extracti64x4_epi64, whose
+   don't-care operand trips the warning under -Werror */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+        if (data.size() > 1) {
+            uint64_t last = data.size() - 1;
+            __m512i acc = _mm512_setzero_si512();
+            for (; word_idx + 8 <= last; word_idx += 8) {
+                acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(WordGetter::get8(d, word_idx)));
+            }
+            total_ones += _mm512_reduce_add_epi64(acc);
+        }
+#pragma GCC diagnostic pop
+#elif defined(__AVX2__)
+        if (data.size() > 1) {
+            uint64_t last = data.size() - 1;
+            const __m256i lut = _mm256_setr_epi8(  //
+                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,  //
+                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+            const __m256i low_mask = _mm256_set1_epi8(0x0f);
+            __m256i acc = _mm256_setzero_si256();
+            for (; word_idx + 4 <= last; word_idx += 4) {
+                __m256i v = WordGetter::get4(d, word_idx);
+                __m256i lo = _mm256_and_si256(v, low_mask);
+                __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+                __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo),  //
+                                              _mm256_shuffle_epi8(lut, hi));
+                acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+            }
+            uint64_t lanes[4];
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+            total_ones += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        }
+#endif
+        for (; word_idx < data.size(); ++word_idx) {
+            total_ones += util::popcount(masked_word(B, word_idx));
+        }
+        m_positions = total_ones;
+
+        uint64_t num_blocks = (total_ones + block_size - 1) / block_size;
+
+        /*
+            Cache-blocked, optionally parallel build: the bitvector is cut at
+            super-block boundaries (multiples of block_size ones), one slice
+            per thread, so every slice emits whole super-blocks into its own
+            partial inventories and the output vectors never compete with the
+            streamed input for the same cache. The ordered merge only
+            concatenates and rebases the overflow indices of sparse blocks.
+            Small inputs take the single-slice path on this thread.
+        */
+        uint64_t num_threads = 1;
+        if (data.size() >= 2 * m_min_words_per_slice) {
+            num_threads = std::min<uint64_t>(std::thread::hardware_concurrency(),
+                                             data.size() / m_min_words_per_slice);
+            num_threads = std::min<uint64_t>(num_threads, num_blocks);
+            if (num_threads == 0) num_threads = 1;
+        }
 
-                cur_block_positions.push_back(cur_pos);
+        std::vector<partial_inventories> partials(num_threads);
+
+        if (num_threads == 1) {
+            build_range(B, 0, total_ones, partials[0]);
+        } else {
+            // ones-space split targets: chunk t starts at the (target[t])-th one
+            std::vector<uint64_t> target(num_threads);
+            uint64_t blocks_per = num_blocks / num_threads;
+            uint64_t rem = num_blocks % num_threads;
+            target[0] = 0;
+            for (uint64_t t = 1; t != num_threads; ++t) {
+                target[t] = target[t - 1] + (blocks_per + (t - 1 < rem)) * block_size;
+            }
 
-                if (cur_block_positions.size() == block_size) {
-                    flush_cur_block(cur_block_positions, block_inventory, subblock_inventory,
-                                    overflow_positions);
+            // locate the bit position of each target one with a popcount scan
+            std::vector<uint64_t> start_bit(num_threads);
+            start_bit[0] = 0;
+            uint64_t seen = 0;
+            for (uint64_t word_idx = 0, t = 1; word_idx < data.size() && t < num_threads;
+                 ++word_idx) {
+                uint64_t word = masked_word(B, word_idx);
+                uint64_t c = util::popcount(word);
+                while (t < num_threads && seen + c > target[t]) {
+                    start_bit[t] = (word_idx << 6) + util::select_in_word(word, target[t] - seen);
+                    ++t;
                 }
+                seen += c;
+            }
 
-                // can't do >>= l + 1, can be 64
-                cur_word >>= 1;
-                cur_pos += 1;
-                m_positions += 1;
+            std::vector<std::thread> threads(num_threads);
+            for (uint64_t t = 0; t != num_threads; ++t) {
+                uint64_t quota = (t + 1 != num_threads ? target[t + 1] : total_ones) - target[t];
+                threads[t] = std::thread([&, t, quota]() {
+                    build_range(B, start_bit[t], quota, partials[t]);
+                });
+            }
+            for (auto& thread : threads) thread.join();
+        }
+
+        // ordered merge: concatenate and rebase sparse overflow indices
+        std::vector<uint64_t> block_entries;
+        block_entries.reserve(num_blocks);
+        m_block_is_sparse.assign((num_blocks + 63) / 64, 0);
+        m_subblock_inventory.clear();
+        m_subblock_inventory.reserve(((total_ones + subblock_size - 1) / subblock_size) *
+                                     samples_per_subblock);
+        m_overflow_positions.clear();
+
+        uint64_t overflow_off = 0;
+        for (auto const& p : partials) {
+            for (uint64_t j = 0; j != p.block_inventory.size(); ++j) {
+                if (p.block_sparse_flags[j]) {
+                    uint64_t block = block_entries.size();
+                    m_block_is_sparse[block >> 6] |= uint64_t(1) << (block & 63);
+                    block_entries.push_back(p.block_inventory[j] + overflow_off);
+                } else {
+                    block_entries.push_back(p.block_inventory[j]);
+                }
             }
+            m_subblock_inventory.insert(m_subblock_inventory.end(), p.subblock_inventory.begin(),
+                                        p.subblock_inventory.end());
+            m_overflow_positions.insert(m_overflow_positions.end(), p.overflow_positions.begin(),
+                                        p.overflow_positions.end());
+            overflow_off += p.overflow_positions.size();
         }
-        if (cur_block_positions.size()) {
-            flush_cur_block(cur_block_positions, block_inventory, subblock_inventory,
-                            overflow_positions);
+
+        /*
+            Bit-pack the merged entries at the width of the largest one
+            (a bit position < num_bits() or an overflow index, whichever
+            dominates): typically 20-40 bits instead of 64 per super-block.
+        */
+        if (!block_entries.empty()) {
+            m_block_inventory.build(block_entries.begin(), block_entries.size());
         }
-        m_block_inventory.swap(block_inventory);
-        m_subblock_inventory.swap(subblock_inventory);
-        m_overflow_positions.swap(overflow_positions);
     }
 
     /*
         Return the position of the i-th bit set in B,
         for any 0 <= i < num_positions();
     */
-    inline uint64_t select(bit_vector const& B, uint64_t i) const {
-        // *** START VANILLA INSTRUMENTATION ***
-        const char* log_prefix = "[V_SELECT]";
-        fprintf(stderr, "%s ENTER select(i=%llu)\n", log_prefix, (unsigned long long)i);
-        // *** END VANILLA INSTRUMENTATION ***
-
+    inline uint64_t select(bit_vector const& B, uint64_t i) const noexcept {
         assert(i < num_positions());
         uint64_t block = i / block_size;
-        // *** START VANILLA INSTRUMENTATION ***
-        fprintf(stderr, "%s  Calculated block = %llu (i=%llu / block_size=%llu)\n", log_prefix, (unsigned long long)block, (unsigned long long)i, (unsigned long long)block_size);
-        if (block >= m_block_inventory.size()) {
-            fprintf(stderr, "%s  ERROR: block index %llu out of bounds (inventory size %zu)\n", log_prefix, (unsigned long long)block, m_block_inventory.size());
-            fprintf(stderr, "%s EXIT select (error) -> returning 0\n", log_prefix);
-            return 0; // Or appropriate error handling
-        }
-        // *** END VANILLA INSTRUMENTATION ***
-
-        int64_t block_pos = m_block_inventory[block];
-        // *** START VANILLA INSTRUMENTATION ***
-        fprintf(stderr, "%s  Looked up block_pos = m_block_inventory[%llu] = %lld\n", log_prefix, (unsigned long long)block, (long long)block_pos);
-        // *** END VANILLA INSTRUMENTATION ***
-
-        if (block_pos < 0) {  // sparse super-block
-            // *** START VANILLA INSTRUMENTATION ***
-            fprintf(stderr, "%s  Block is SPARSE (block_pos < 0)\n", log_prefix);
-            // *** END VANILLA INSTRUMENTATION ***
-            uint64_t overflow_pos = uint64_t(-block_pos - 1);
-            uint64_t index_in_block = i & (block_size - 1);
-            uint64_t final_overflow_idx = overflow_pos + index_in_block;
-            // *** START VANILLA INSTRUMENTATION ***
-            fprintf(stderr, "%s    Calculated overflow_pos = %llu\n", log_prefix, (unsigned long long)overflow_pos);
-            fprintf(stderr, "%s    Calculated index_in_block = %llu (i & (block_size - 1))\n", log_prefix, (unsigned long long)index_in_block);
-            fprintf(stderr, "%s    Target overflow index = %llu\n", log_prefix, (unsigned long long)final_overflow_idx);
-            if (final_overflow_idx >= m_overflow_positions.size()) {
-                 fprintf(stderr, "%s    ERROR: final overflow index %llu out of bounds (overflow size %zu)\n", log_prefix, (unsigned long long)final_overflow_idx, m_overflow_positions.size());
-                 fprintf(stderr, "%s EXIT select (sparse error) -> returning 0\n", log_prefix);
-                 return 0; 
-            }
-            // *** END VANILLA INSTRUMENTATION ***
-            uint64_t result = m_overflow_positions[final_overflow_idx];
-            // *** START VANILLA INSTRUMENTATION ***
-            fprintf(stderr, "%s    Result from m_overflow_positions[%llu] = %llu\n", log_prefix, (unsigned long long)final_overflow_idx, (unsigned long long)result);
-            fprintf(stderr, "%s EXIT select (sparse) -> %llu\n", log_prefix, (unsigned long long)result);
-            // *** END VANILLA INSTRUMENTATION ***
-            return result;
-        }
-
-        // *** START VANILLA INSTRUMENTATION ***
-        fprintf(stderr, "%s  Block is DENSE (block_pos >= 0)\n", log_prefix);
-        // *** END VANILLA INSTRUMENTATION ***
         uint64_t subblock = i / subblock_size;
-        // *** START VANILLA INSTRUMENTATION ***
-        fprintf(stderr, "%s    Calculated subblock = %llu (i=%llu / subblock_size=%llu)\n", log_prefix, (unsigned long long)subblock, (unsigned long long)i, (unsigned long long)subblock_size);
-        if (subblock >= m_subblock_inventory.size()) {
-            fprintf(stderr, "%s    ERROR: subblock index %llu out of bounds (inventory size %zu)\n", log_prefix, (unsigned long long)subblock, m_subblock_inventory.size());
-            fprintf(stderr, "%s EXIT select (error) -> returning 0\n", log_prefix);
-            return 0; // Or appropriate error handling
+        /*
+            The inventories are pointer-chased random accesses; start the
+            subblock line while the load of m_block_inventory[block] and the
+            sparse/dense branch resolve, so a dense query does not serialize
+            two cold misses. (Sparse queries waste the hint, but they touch
+            m_overflow_positions whose address depends on the block entry.)
+        */
+        /* hoisted, __restrict: tells the compiler the sample array does not
+           alias the other inventories, so its base stays in a register */
+        uint16_t const* __restrict samples = m_subblock_inventory.data();
+        __builtin_prefetch(samples + subblock * samples_per_subblock);
+        uint64_t block_pos = m_block_inventory[block];
+        /*
+            Branch hints (__builtin_expect: the tree is C++17, predating
+            [[likely]]): sparse super-blocks only appear when 1024 ones
+            span more than 64 Ki bits, and a zero reminder hits one query
+            in sample_stride, so the dense scan below is laid out as the
+            fall-through path and the cold exits move out of the way.
+        */
+        if (__builtin_expect((m_block_is_sparse[block >> 6] >> (block & 63)) & 1, 0)) {
+            return m_overflow_positions[block_pos + (i & (block_size - 1))];
         }
-        // *** END VANILLA INSTRUMENTATION ***
-
-        uint64_t start_pos = uint64_t(block_pos) + m_subblock_inventory[subblock];
-        // *** START VANILLA INSTRUMENTATION ***
-        fprintf(stderr, "%s    Looked up subblock offset = m_subblock_inventory[%llu] = %hu\n", log_prefix, (unsigned long long)subblock, m_subblock_inventory[subblock]);
-        fprintf(stderr, "%s    Calculated start_pos = %llu (block_pos %llu + offset %hu)\n", log_prefix, (unsigned long long)start_pos, (unsigned long long)block_pos, m_subblock_inventory[subblock]);
-        // *** END VANILLA INSTRUMENTATION ***
 
         uint64_t reminder = i & (subblock_size - 1);
-        // *** START VANILLA INSTRUMENTATION ***
-        fprintf(stderr, "%s    Calculated reminder = %llu (i & (subblock_size - 1))\n", log_prefix, (unsigned long long)reminder);
-        // *** END VANILLA INSTRUMENTATION ***
-
-        if (!reminder) {
-            // *** START VANILLA INSTRUMENTATION ***
-            fprintf(stderr, "%s    Reminder is 0, returning start_pos directly.\n", log_prefix);
-            fprintf(stderr, "%s EXIT select (dense, reminder=0) -> %llu\n", log_prefix, (unsigned long long)start_pos);
-            // *** END VANILLA INSTRUMENTATION ***
-            return start_pos;
-        }
+        /*
+            Each subblock carries samples_per_subblock position samples,
+            one every sample_stride ones, consecutive in memory so they
+            share a cache line. Jumping to the closest preceding sample
+            bounds the scan below to fewer than sample_stride ones,
+            regardless of how the bits are distributed inside the block.
+        */
+        uint64_t start_pos =
+            uint64_t(block_pos) +
+            samples[subblock * samples_per_subblock + reminder / sample_stride];
+        reminder &= sample_stride - 1;
+        /* hoisted, __restrict: the scan touches only the bitvector words,
+           so the compiler may keep the base address in a register */
+        uint64_t const* __restrict d = B.data().data();
+        uint64_t num_words = B.data().size();
+        // start fetching the scan's first line while the checks below retire
+        __builtin_prefetch(d + (start_pos >> 6));
+        if (__builtin_expect(reminder == 0, 0)) return start_pos;
 
-        // *** START VANILLA INSTRUMENTATION ***
-        fprintf(stderr, "%s    Reminder > 0, scanning forward from start_pos %llu\n", log_prefix, (unsigned long long)start_pos);
-        // *** END VANILLA INSTRUMENTATION ***
-        std::vector<uint64_t> const& data = B.data();
         uint64_t word_idx = start_pos >> 6;
         uint64_t word_shift = start_pos & 63;
-        // *** START VANILLA INSTRUMENTATION ***
-        fprintf(stderr, "%s      Initial word_idx = %llu, word_shift = %llu\n", log_prefix, (unsigned long long)word_idx, (unsigned long long)word_shift);
-        if (word_idx >= data.size()) {
-            fprintf(stderr, "%s      ERROR: initial word_idx %llu out of bounds (data size %zu)\n", log_prefix, (unsigned long long)word_idx, data.size());
-            fprintf(stderr, "%s EXIT select (error) -> returning 0\n", log_prefix);
-            return 0;
-        }
-        // *** END VANILLA INSTRUMENTATION ***
-
-        uint64_t word = WordGetter()(data, word_idx) & (uint64_t(-1) << word_shift);
-        // *** START VANILLA INSTRUMENTATION ***
-        uint64_t original_first_word = WordGetter()(data, word_idx);
-        fprintf(stderr, "%s      First word raw (data[%llu]) = 0x%llX\n", log_prefix, (unsigned long long)word_idx, (unsigned long long)original_first_word);
-        fprintf(stderr, "%s      First word masked (>> %llu) = 0x%llX\n", log_prefix, (unsigned long long)word_shift, (unsigned long long)word);
-        uint64_t loop_count = 0;
-        // *** END VANILLA INSTRUMENTATION ***
-
+        uint64_t word = WordGetter::get(d, word_idx) & (uint64_t(-1) << word_shift);
         while (true) {
-            // *** START VANILLA INSTRUMENTATION ***
-            loop_count++;
-            if (loop_count > (B.num_bits() / 64 + 2)) { // Safety break
-                 fprintf(stderr, "%s      ERROR: Scan loop exceeded safety limit (%llu iterations)!\n", log_prefix, (unsigned long long)loop_count);
-                 fprintf(stderr, "%s EXIT select (error) -> returning 0\n", log_prefix);
-                 return 0;
-            }
-            // *** END VANILLA INSTRUMENTATION ***
+            // stay a cache line ahead of the scan; prefetching past the end
+            // of the vector is harmless
+            __builtin_prefetch(d + word_idx + 8, 0, 0);
             uint64_t popcnt = util::popcount(word);
-            // *** START VANILLA INSTRUMENTATION ***
-            fprintf(stderr, "%s      Loop %llu: word=0x%llX, popcnt=%llu, current reminder=%llu\n", log_prefix, (unsigned long long)loop_count, (unsigned long long)word, (unsigned long long)popcnt, (unsigned long long)reminder);
-            // *** END VANILLA INSTRUMENTATION ***
-            if (reminder < popcnt) {
-                 // *** START VANILLA INSTRUMENTATION ***
-                 fprintf(stderr, "%s        Reminder %llu < popcnt %llu, break loop.\n", log_prefix, (unsigned long long)reminder, (unsigned long long)popcnt);
-                 // *** END VANILLA INSTRUMENTATION ***
-                 break;
-            }
+            if (reminder < popcnt) break;
             reminder -= popcnt;
-            word_idx++;
-            // *** START VANILLA INSTRUMENTATION ***
-            fprintf(stderr, "%s        Reminder >= popcnt, reminder becomes %llu. Increment word_idx to %llu.\n", log_prefix, (unsigned long long)reminder, (unsigned long long)word_idx);
-            if (word_idx >= data.size()) {
-                fprintf(stderr, "%s        ERROR: next word_idx %llu out of bounds (data size %zu)!\n", log_prefix, (unsigned long long)word_idx, data.size());
-                fprintf(stderr, "%s EXIT select (error) -> returning 0\n", log_prefix);
-                return 0;
+            ++word_idx;
+#if defined(__AVX512VPOPCNTDQ__) && defined(__AVX512F__)
+            /*
+                Resolve eight words at a time: VPOPCNTDQ gives the eight
+                lane popcounts, a Hillis-Steele pass (three shift-lane
+                adds) turns them into an inclusive prefix sum, and one
+                unsigned compare against the reminder finds the containing
+                word directly, so the query finishes with select_in_word
+                instead of falling back to a scalar word-by-word walk.
+                All-smaller groups (mask == 0) are skipped whole.
+            */
+/* GCC 12 flags the _mm512_undefined_epi32() inside _mm512_alignr_epi64 as
+   maybe-uninitialized; it is the intrinsic's documented don't-care operand
+   (every lane is overwritten), but the false positive breaks -Werror builds
+   on AVX512 hosts. */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+            while (word_idx + 8 <= num_words) {
+                __m512i pc = _mm512_popcnt_epi64(WordGetter::get8(d, word_idx));
+                const __m512i z = _mm512_setzero_si512();
+                __m512i pre = _mm512_add_epi64(pc, _mm512_alignr_epi64(pc, z, 7));
+                pre = _mm512_add_epi64(pre, _mm512_alignr_epi64(pre, z, 6));
+                pre = _mm512_add_epi64(pre, _mm512_alignr_epi64(pre, z, 4));
+                __mmask8 gt = _mm512_cmpgt_epu64_mask(pre, _mm512_set1_epi64(reminder));
+                if (gt) {
+                    uint64_t prefix[8];
+                    _mm512_storeu_si512(prefix, pre);
+                    uint64_t lane = util::lsbll(gt);
+                    word_idx += lane;
+                    if (lane) reminder -= prefix[lane - 1];
+                    word = WordGetter::get(d, word_idx);
+                    return (word_idx << 6) + util::select_in_word(word, reminder);
+                }
+                reminder -= uint64_t(_mm512_reduce_add_epi64(pc));
+                word_idx += 8;
+            }
+#pragma GCC diagnostic pop
+#elif defined(__AVX2__)
+            /*
+                Bulk-skip whole words four at a time: a nibble-LUT popcount
+                (shuffle + sad) yields the four per-word counts in one shot,
+                so the scan pays one well-predicted branch per 256 bits
+                instead of one data-dependent branch per word. Once the
+                target falls within the next four words, the scalar loop
+                above finishes the job (at most three iterations).
+            */
+            while (word_idx + 4 <= num_words) {
+                const __m256i lut = _mm256_setr_epi8(  //
+                    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,  //
+                    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+                const __m256i low_mask = _mm256_set1_epi8(0x0f);
+                __m256i v = WordGetter::get4(d, word_idx);
+                __m256i lo = _mm256_and_si256(v, low_mask);
+                __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+                __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo),  //
+                                              _mm256_shuffle_epi8(lut, hi));
+                __m256i pop4 = _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+                uint64_t pops[4];
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pops), pop4);
+                uint64_t sum = pops[0] + pops[1] + pops[2] + pops[3];
+                if (reminder < sum) break;
+                reminder -= sum;
+                word_idx += 4;
+            }
+#elif defined(__ARM_NEON)
+            /*
+                Bulk-skip whole words two at a time: cnt.16b + addv gives the
+                128-bit popcount in two instructions and beats the serial
+                64-bit popcount chain even at this narrow width. The scalar
+                loop above finishes the last word when the target falls
+                within the pair.
+            */
+            while (word_idx + 2 <= num_words) {
+                uint8x16_t v = WordGetter::get2(d, word_idx);
+                uint64_t sum = vaddvq_u8(vcntq_u8(v));
+                if (reminder < sum) break;
+                reminder -= sum;
+                word_idx += 2;
             }
-            // *** END VANILLA INSTRUMENTATION ***
-            word = WordGetter()(data, word_idx);
+#endif
+            word = WordGetter::get(d, word_idx);
         }
+        return (word_idx << 6) + util::select_in_word(word, reminder);
+    }
 
-        // *** START VANILLA INSTRUMENTATION ***
-        fprintf(stderr, "%s      Loop finished. Final word_idx=%llu, word=0x%llX, reminder=%llu\n", log_prefix, (unsigned long long)word_idx, (unsigned long long)word, (unsigned long long)reminder);
-        fprintf(stderr, "%s      Calling util::select_in_word(0x%llX, %llu)...\n", log_prefix, (unsigned long long)word, (unsigned long long)reminder);
-        // *** END VANILLA INSTRUMENTATION ***
-        uint64_t pos_in_word = util::select_in_word(word, reminder);
-        uint64_t result = (word_idx << 6) + pos_in_word;
-        // *** START VANILLA INSTRUMENTATION ***
-        fprintf(stderr, "%s      select_in_word returned %llu\n", log_prefix, (unsigned long long)pos_in_word);
-        fprintf(stderr, "%s EXIT select (dense) -> %llu ((word_idx %llu << 6) + pos_in_word %llu)\n", log_prefix, (unsigned long long)result, (unsigned long long)word_idx, (unsigned long long)pos_in_word);
-        // *** END VANILLA INSTRUMENTATION ***
-        return result;
+    /*
+        Start fetching the inventory lines select(B, i) will read, without
+        resolving anything. Callers that know a rank ahead of time can issue
+        this early so the select's first two misses overlap preceding work.
+    */
+    inline void prefetch(uint64_t i) const noexcept {
+        __builtin_prefetch(m_block_inventory.data().data() +
+                           ((i / block_size) * m_block_inventory.width() >> 6));
+        __builtin_prefetch(m_subblock_inventory.data() +
+                           (i / subblock_size) * samples_per_subblock);
+    }
+
+    /*
+        Batched select: out[k] = select(B, is[k]) for all 0 <= k < n.
+
+        Two wins over n independent select() calls. First, the inventory
+        lines of upcoming queries are prefetched a fixed distance ahead, so
+        their cache misses overlap instead of serializing. Second, when the
+        ranks are consecutive (Elias-Fano's common access pattern) each
+        answer is the next set bit after the previous one, so the whole
+        batch collapses into one linear sweep over the bit vector; the sweep
+        is capped at a few words per step and falls back to a plain select()
+        when the gap is larger than that.
+    */
+    void select_batch(bit_vector const& B, uint64_t const* is, uint64_t n,
+                      uint64_t* out) const noexcept {
+        static constexpr uint64_t lookahead = 8;
+        static constexpr uint64_t max_sweep_words = 4;
+        uint64_t const* __restrict d = B.data().data();
+        uint64_t const* block_words = m_block_inventory.data().data();
+        uint64_t block_width = m_block_inventory.width();
+        for (uint64_t k = 0; k != n && k != lookahead; ++k) {
+            __builtin_prefetch(block_words + ((is[k] / block_size) * block_width >> 6));
+            __builtin_prefetch(m_subblock_inventory.data() +
+                               (is[k] / subblock_size) * samples_per_subblock);
+        }
+        bool have_prev = false;
+        uint64_t prev_i = 0;
+        uint64_t word_idx = 0;
+        uint64_t word = 0;  // bits of data[word_idx] strictly above the previous answer
+        for (uint64_t k = 0; k != n; ++k) {
+            if (k + lookahead < n) {
+                __builtin_prefetch(block_words +
+                                   ((is[k + lookahead] / block_size) * block_width >> 6));
+                __builtin_prefetch(m_subblock_inventory.data() +
+                                   (is[k + lookahead] / subblock_size) * samples_per_subblock);
+            }
+            uint64_t i = is[k];
+            assert(i < num_positions());
+            if (have_prev && i == prev_i + 1) {
+                /* the answer is the next set bit after out[k - 1]: sweep
+                   forward, but give up after a few empty words since a
+                   fresh select() resolves long gaps in O(1) via the
+                   inventories */
+                uint64_t scan_idx = word_idx;
+                uint64_t scan_word = word;
+                uint64_t limit = scan_idx + max_sweep_words;
+                while (scan_word == 0 && scan_idx != limit) {
+                    scan_word = WordGetter::get(d, ++scan_idx);
+                }
+                if (scan_word != 0) {
+                    word_idx = scan_idx;
+                    out[k] = (word_idx << 6) + util::lsbll(scan_word);
+                    word = scan_word & (scan_word - 1);
+                    prev_i = i;
+                    continue;
+                }
+            }
+            out[k] = select(B, i);
+            word_idx = out[k] >> 6;
+            word = WordGetter::get(d, word_idx) & (uint64_t(-1) << (out[k] & 63));
+            word &= word - 1;  // drop the bit just returned
+            have_prev = true;
+            prev_i = i;
+        }
     }
 
-    inline uint64_t num_positions() const { return m_positions; }
+    inline uint64_t num_positions() const noexcept { return m_positions; }
 
-    uint64_t num_bytes() const {
-        return sizeof(m_positions) + essentials::vec_bytes(m_block_inventory) +
+    uint64_t num_bytes() const noexcept {
+        return sizeof(m_positions) + m_block_inventory.num_bytes() +
+               essentials::vec_bytes(m_block_is_sparse) +
                essentials::vec_bytes(m_subblock_inventory) +
                essentials::vec_bytes(m_overflow_positions);
     }
@@ -273,6 +479,7 @@ struct darray {
     void swap(darray& other) {
         std::swap(m_positions, other.m_positions);
         m_block_inventory.swap(other.m_block_inventory);
+        m_block_is_sparse.swap(other.m_block_is_sparse);
         m_subblock_inventory.swap(other.m_subblock_inventory);
         m_overflow_positions.swap(other.m_overflow_positions);
     }
@@ -289,9 +496,12 @@ struct darray {
 
     // *** START TEMPORARY PUBLIC GETTERS FOR TESTING ***
     public:
-        const std::vector<int64_t>& getBlockInventory() const {
+        const compact_vector& getBlockInventory() const {
             return m_block_inventory;
         }
+        const std::vector<uint64_t>& getBlockIsSparse() const {
+            return m_block_is_sparse;
+        }
         const std::vector<uint16_t>& getSubblockInventory() const {
             return m_subblock_inventory;
         }
@@ -304,110 +514,223 @@ struct darray {
     // *** END TEMPORARY PUBLIC GETTERS FOR TESTING ***
 
 protected:
-    uint64_t m_positions;
-    std::vector<int64_t> m_block_inventory;
-    std::vector<uint16_t> m_subblock_inventory;
-    std::vector<uint64_t> m_overflow_positions;
+    /* 4 MiB of bitvector per build slice before threading pays off */
+    static constexpr uint64_t m_min_words_per_slice = (4 * 1024 * 1024) / sizeof(uint64_t);
 
-    template <typename Visitor, typename T>
-    static void visit_impl(Visitor& visitor, T&& t) {
-        // *** ADDED INSTRUMENTATION START ***
-        // Use a context-dependent prefix set by the caller (elias_fano)
-        const char* darray_prefix = instrumentation_context::get_prefix("[DARRAY_VISIT_UNKNOWN]");
+    /*
+        Position samples per subblock: one every sample_stride ones, laid
+        out consecutively so all of a subblock's samples share a cache
+        line. Finer sampling trades inventory space for a shorter scan.
+    */
+    static constexpr uint64_t samples_per_subblock = 4;
+    static constexpr uint64_t sample_stride = subblock_size / samples_per_subblock;
+    static_assert(subblock_size % samples_per_subblock == 0,
+                  "subblock_size must be a multiple of samples_per_subblock");
+
+    /* per-slice outputs of build_range, concatenated by the ordered merge */
+    struct partial_inventories {
+        std::vector<uint64_t> block_inventory;    // sparse overflow indices still local
+        std::vector<uint8_t> block_sparse_flags;  // 1 byte per local block
+        std::vector<uint16_t> subblock_inventory;
+        std::vector<uint64_t> overflow_positions;
+    };
 
-        // Log m_positions
-        PTHASH_LOG("%s.POSITIONS.BEFORE Value: %llu, Offset: %zu\n",
-                darray_prefix, (unsigned long long)t.m_positions, (size_t)visitor.bytes());
-        visitor.visit(t.m_positions);
-        PTHASH_LOG("%s.POSITIONS.AFTER Offset: %zu\n",
-                darray_prefix, (size_t)visitor.bytes());
-
-        // Log m_block_inventory
-        PTHASH_LOG("%s.BLOCK_INV.BEFORE Size: %lu, Offset: %zu\n",
-                darray_prefix, (unsigned long)t.m_block_inventory.size(), (size_t)visitor.bytes());
-#ifdef PTHASH_ENABLE_INSTRUMENTATION // Only loop if instrumentation is on
-        for(size_t i = 0; i < t.m_block_inventory.size(); ++i) {
-            // Log as signed int64_t as per the type definition
-            PTHASH_LOG("%s.BLOCK_INV_DATA[%zu]=%lld\n",
-                    darray_prefix, i, (long long)t.m_block_inventory[i]);
-        }
-#endif
-        visitor.visit(t.m_block_inventory); // This will log size + data via vector visitor
-        PTHASH_LOG("%s.BLOCK_INV.AFTER Offset: %zu\n",
-                darray_prefix, (size_t)visitor.bytes());
-
-
-        // Log m_subblock_inventory
-        PTHASH_LOG("%s.SUBBLOCK_INV.BEFORE Size: %lu, Offset: %zu\n",
-                darray_prefix, (unsigned long)t.m_subblock_inventory.size(), (size_t)visitor.bytes());
-#ifdef PTHASH_ENABLE_INSTRUMENTATION // Only loop if instrumentation is on
-        for(size_t i = 0; i < t.m_subblock_inventory.size(); ++i) {
-            // Log as unsigned uint16_t
-            PTHASH_LOG("%s.SUBBLOCK_INV_DATA[%zu]=%hu\n",
-                    darray_prefix, i, (unsigned short)t.m_subblock_inventory[i]);
+    /* the word at word_idx with the padding bits beyond num_bits() cleared
+       (the negating getter turns them into spurious ones) */
+    static uint64_t masked_word(bit_vector const& B, uint64_t word_idx) {
+        uint64_t word = WordGetter::get(B.data().data(), word_idx);
+        if (((word_idx + 1) << 6) > B.num_bits()) {
+            word &= (uint64_t(1) << (B.num_bits() & 63)) - 1;
         }
+        return word;
+    }
+
+    /*
+        Emit the inventories for the slice that starts at start_bit (the
+        first one of a super-block) and covers the next quota ones. Every
+        position is appended eagerly to overflow_positions (a sequential
+        write into reserved storage) while the subblock sample positions
+        are captured on the fly. At the end of a super-block the
+        dense/sparse decision is made from first/last alone: a sparse
+        block keeps its positions where they already are, a dense block
+        truncates them away and emits the relative samples. No
+        O(block_size) staging buffer and no second pass over the block.
+    */
+    static void build_range(bit_vector const& B, uint64_t start_bit, uint64_t quota,
+                            partial_inventories& out) {
+        std::vector<uint64_t> const& data = B.data();
+        uint64_t const* __restrict d = data.data();
+        uint64_t num_local_blocks = (quota + block_size - 1) / block_size;
+        out.block_inventory.reserve(num_local_blocks);
+        out.block_sparse_flags.assign(num_local_blocks, 0);
+        out.subblock_inventory.reserve(((quota + subblock_size - 1) / subblock_size) *
+                                       samples_per_subblock);
+        /*
+            Pre-size the per-bit output once (quota is an exact upper bound:
+            all blocks sparse) and write through a raw pointer + counter, so
+            the hottest loop carries no capacity check at all; the final
+            resize trims the positions that dense blocks discarded.
+        */
+        out.overflow_positions.resize(quota);
+        uint64_t* overflow = out.overflow_positions.data();
+        uint64_t overflow_count = 0;
+
+        uint64_t block_first = 0;
+        uint64_t block_last = 0;
+        uint64_t bits_in_block = 0;
+        uint64_t overflow_start = 0;
+        uint64_t subblock_samples[block_size / sample_stride];
+
+        auto flush_cur_block = [&]() {
+            uint64_t num_subblocks = (bits_in_block + subblock_size - 1) / subblock_size;
+            uint64_t num_slots = num_subblocks * samples_per_subblock;
+            uint64_t sb_base = out.subblock_inventory.size();
+            out.subblock_inventory.resize(sb_base + num_slots);
+            uint16_t* sb = out.subblock_inventory.data() + sb_base;
+            if (block_last - block_first < (1ULL << 16))  // dense case
+            {
+                out.block_inventory.push_back(block_first);
+                /*
+                    Subtract + narrow over the contiguous sample array:
+                    a plain indexed loop over pre-sized storage, so the
+                    compiler vectorizes the 64-to-16-bit packing instead of
+                    emitting one push_back per sample. A sample only exists
+                    if its rank is populated; slots past the last one get a
+                    sentinel and are never queried.
+                */
+                uint64_t num_samples = (bits_in_block + sample_stride - 1) / sample_stride;
+                for (uint64_t j = 0; j != num_samples; ++j) {
+                    sb[j] = uint16_t(subblock_samples[j] - block_first);
+                }
+                std::fill(sb + num_samples, sb + num_slots, uint16_t(-1));
+                overflow_count = overflow_start;  // discard the buffered positions
+            } else  // sparse case
+            {
+                out.block_sparse_flags[out.block_inventory.size()] = 1;
+                out.block_inventory.push_back(overflow_start);
+                std::fill(sb, sb + num_slots, uint16_t(-1));
+            }
+            bits_in_block = 0;
+        };
+
+        uint64_t ones_done = 0;
+        for (uint64_t word_idx = start_bit >> 6; word_idx < data.size() && ones_done < quota;
+             ++word_idx) {
+            uint64_t base = word_idx << 6;
+            uint64_t cur_word = WordGetter::get(d, word_idx);
+            if (word_idx == start_bit >> 6) cur_word &= uint64_t(-1) << (start_bit & 63);
+#if defined(__AVX2__)
+            /*
+                On sparse stretches most words are empty; test the next
+                four at once and leap over all-zero runs, so the pass is
+                bounded by the zero-check bandwidth instead of paying a
+                load + branch per empty word.
+            */
+            if (cur_word == 0) {
+                while (word_idx + 5 <= data.size()) {
+                    __m256i v = WordGetter::get4(d, word_idx + 1);
+                    if (!_mm256_testz_si256(v, v)) break;
+                    word_idx += 4;
+                }
+                continue;
+            }
 #endif
-        visitor.visit(t.m_subblock_inventory); // This will log size + data via vector visitor
-        PTHASH_LOG("%s.SUBBLOCK_INV.AFTER Offset: %zu\n",
-                darray_prefix, (size_t)visitor.bytes());
-
-        // Log m_overflow_positions
-        PTHASH_LOG("%s.OVERFLOW_POS.BEFORE Size: %lu, Offset: %zu\n",
-                darray_prefix, (unsigned long)t.m_overflow_positions.size(), (size_t)visitor.bytes());
-#ifdef PTHASH_ENABLE_INSTRUMENTATION // Only loop if instrumentation is on
-        for(size_t i = 0; i < t.m_overflow_positions.size(); ++i) {
-            // Log as unsigned uint64_t
-            PTHASH_LOG("%s.OVERFLOW_POS_DATA[%zu]=%llu\n",
-                    darray_prefix, i, (unsigned long long)t.m_overflow_positions[i]);
+            // one TZCNT + one BLSR per set bit: clearing the lowest bit with
+            // w & (w - 1) avoids the old shift-by-l-then-by-one dance and its
+            // per-bit bookkeeping
+            while (cur_word) {
+                uint64_t cur_pos = base + util::lsbll(cur_word);
+                if (cur_pos >= B.num_bits()) break;
+
+                if (bits_in_block == 0) {
+                    block_first = cur_pos;
+                    overflow_start = overflow_count;
+                }
+                if ((bits_in_block & (sample_stride - 1)) == 0) {
+                    subblock_samples[bits_in_block / sample_stride] = cur_pos;
+                }
+                overflow[overflow_count++] = cur_pos;
+                block_last = cur_pos;
+                ++bits_in_block;
+
+                if (bits_in_block == block_size) flush_cur_block();
+
+                if (++ones_done == quota) break;
+                cur_word &= cur_word - 1;
+            }
         }
-#endif
-        visitor.visit(t.m_overflow_positions); // This will log size + data via vector visitor
-        PTHASH_LOG("%s.OVERFLOW_POS.AFTER Offset: %zu\n",
-                darray_prefix, (size_t)visitor.bytes());
+        if (bits_in_block) flush_cur_block();
+        out.overflow_positions.resize(overflow_count);
+    }
 
-        // *** ADDED INSTRUMENTATION END ***
+    uint64_t m_positions;
+    compact_vector m_block_inventory;  // bit-packed, one entry per super-block
+    std::vector<uint64_t> m_block_is_sparse;  // 1 bit per super-block
+    std::vector<uint16_t> m_subblock_inventory;  // samples_per_subblock entries per subblock
+    std::vector<uint64_t> m_overflow_positions;
 
-        /* Original code was likely just this:
+    template <typename Visitor, typename T>
+    static void visit_impl(Visitor& visitor, T&& t) {
+        // one summary line instead of the old per-element dump loops
+        PTHASH_LOG("[DARRAY_VISIT] positions=%llu blocks=%llu subblock_samples=%llu overflow=%llu\n",
+                   (unsigned long long)t.m_positions,
+                   (unsigned long long)t.m_block_inventory.size(),
+                   (unsigned long long)t.m_subblock_inventory.size(),
+                   (unsigned long long)t.m_overflow_positions.size());
         visitor.visit(t.m_positions);
         visitor.visit(t.m_block_inventory);
+        visitor.visit(t.m_block_is_sparse);
         visitor.visit(t.m_subblock_inventory);
         visitor.visit(t.m_overflow_positions);
-        */
     }
 
-    static void flush_cur_block(std::vector<uint64_t>& cur_block_positions,
-                                std::vector<int64_t>& block_inventory,
-                                std::vector<uint16_t>& subblock_inventory,
-                                std::vector<uint64_t>& overflow_positions) {
-        if (cur_block_positions.back() - cur_block_positions.front() < (1ULL << 16))  // dense case
-        {
-            block_inventory.push_back(int64_t(cur_block_positions.front()));
-            for (uint64_t i = 0; i < cur_block_positions.size(); i += subblock_size) {
-                subblock_inventory.push_back(
-                    uint16_t(cur_block_positions[i] - cur_block_positions.front()));
-            }
-        } else  // sparse case
-        {
-            block_inventory.push_back(-int64_t(overflow_positions.size()) - 1);
-            for (uint64_t i = 0; i < cur_block_positions.size(); ++i) {
-                overflow_positions.push_back(cur_block_positions[i]);
-            }
-            for (uint64_t i = 0; i < cur_block_positions.size(); i += subblock_size) {
-                subblock_inventory.push_back(uint16_t(-1));
-            }
-        }
-        cur_block_positions.clear();
-    }
 };
 
 namespace util {
 
+/*
+    The getters are stateless: static functions over a raw word pointer,
+    so a call compiles to a plain (possibly negated) load and the caller
+    can hoist the pointer into a register once per scan.
+*/
 struct identity_getter {
-    uint64_t operator()(std::vector<uint64_t> const& data, uint64_t i) const { return data[i]; }
+    static uint64_t get(uint64_t const* data, uint64_t i) { return data[i]; }
+#ifdef __AVX2__
+    static __m256i get4(uint64_t const* data, uint64_t i) {
+        return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i));
+    }
+#endif
+#ifdef __AVX512F__
+    static __m512i get8(uint64_t const* data, uint64_t i) {
+        return _mm512_loadu_si512(data + i);
+    }
+#endif
+#ifdef __ARM_NEON
+    static uint8x16_t get2(uint64_t const* data, uint64_t i) {
+        return vreinterpretq_u8_u64(vld1q_u64(data + i));
+    }
+#endif
 };
 
 struct negating_getter {
-    uint64_t operator()(std::vector<uint64_t> const& data, uint64_t i) const { return ~data[i]; }
+    static uint64_t get(uint64_t const* data, uint64_t i) { return ~data[i]; }
+#ifdef __AVX2__
+    static __m256i get4(uint64_t const* data, uint64_t i) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i));
+        return _mm256_xor_si256(v, _mm256_set1_epi64x(-1));
+    }
+#endif
+#ifdef __AVX512F__
+    static __m512i get8(uint64_t const* data, uint64_t i) {
+        __m512i v = _mm512_loadu_si512(data + i);
+        return _mm512_xor_si512(v, _mm512_set1_epi64(-1));
+    }
+#endif
+#ifdef __ARM_NEON
+    static uint8x16_t get2(uint64_t const* data, uint64_t i) {
+        return vmvnq_u8(vreinterpretq_u8_u64(vld1q_u64(data + i)));
+    }
+#endif
 };
 
 }  // namespace util
@@ -6,10 +6,44 @@
 // instrumentation_context is now defined in darray.hpp
 
 #include <iterator>
+#include <type_traits>
 #include <cstdio> // For fprintf
 
 namespace bits {
 
+namespace detail {
+
+/*
+    Stand-in for the zeros select index when index_zeros = false: the member
+    then occupies no storage, is skipped by save/load, and contributes zero
+    to num_bytes(), instead of carrying a constructed-but-empty darray.
+*/
+struct no_darray {
+    uint64_t num_bytes() const { return 0; }
+    void swap(no_darray&) {}
+    template <typename Visitor>
+    void visit(Visitor&) const {}
+    template <typename Visitor>
+    void visit(Visitor&) {}
+};
+
+/*
+    Random-access detection for encode(): raw pointers qualify, and class
+    iterators are probed for their nested iterator_category directly.
+    std::iterator_traits is deliberately avoided - in C++17 it is the empty
+    SFINAE specialization for iterators that define iterator_category but
+    not all five nested typedefs (e.g. mm::file_source's iterator), which
+    would make the trait ill-formed right where it is needed.
+*/
+template <typename Iterator, typename = void>
+struct is_random_access : std::is_pointer<Iterator> {};
+
+template <typename Iterator>
+struct is_random_access<Iterator, std::void_t<typename Iterator::iterator_category>>
+    : std::is_same<typename Iterator::iterator_category, std::random_access_iterator_tag> {};
+
+}  // namespace detail
+
 template <  //
     /* build a succinct select index on the zeros of high_bits for efficient next_neq */
     bool index_zeros = false,  //
@@ -20,7 +54,7 @@ template <  //
     typename DArray0 = darray0   //
     >
 struct elias_fano {
-    elias_fano() : m_back(0) {}
+    elias_fano() : m_back(0), m_l(0), m_low_mask(0) {}
 
     template <typename Iterator>
     void encode(Iterator begin, uint64_t n, uint64_t universe = uint64_t(-1)) {
@@ -34,14 +68,22 @@ struct elias_fano {
         } else {
             if (universe == uint64_t(-1))  // otherwise use the provided universe
             {
-                if constexpr (std::is_same_v<typename Iterator::iterator_category,
-                                             std::random_access_iterator_tag>) {
+                if constexpr (detail::is_random_access<Iterator>::value) {
                     universe = *(begin + (n - 1));
-                } else {  // scan
+                } else {
+                    /*
+                        The iterator cannot jump to the last element and walking
+                        it twice (once to find the universe, once to encode)
+                        doubles the traversal cost when the iterator is
+                        expensive, e.g. a decompressing one. Materialize the
+                        values in a single pass instead: the last one is the
+                        universe since the sequence is sorted.
+                    */
+                    std::vector<uint64_t> buf(n);
                     auto tmp = begin;
-                    for (uint64_t i = 0; i != n - 1; ++i, ++tmp)
-                        ;
-                    universe = *tmp;
+                    for (uint64_t i = 0; i != n; ++i, ++tmp) buf[i] = *tmp;
+                    encode(buf.begin(), n, buf.back());
+                    return;
                 }
             }
         }
@@ -63,55 +105,112 @@ struct elias_fano {
         const uint64_t low_mask = (uint64_t(1) << l) - 1;
         uint64_t last = 0;
 
+        /*
+            Both outputs are written through streaming writers: the low bits
+            pack into a register spilled one full word at a time, and the
+            high-bits ones accumulate per word with a single store when the
+            (increasing) position moves on - instead of a read-modify-write
+            into each structure per element.
+        */
+        bit_vector::builder::one_stream hb_out(&bvb_high_bits);
+        compact_vector::builder::stream lb_out(&cvb_low_bits);
+
         // add a zero at the beginning
         if constexpr (encode_prefix_sum) {
-            if (l) cvb_low_bits.set(0, 0);
-            bvb_high_bits.set(0, 1);
+            if (l) lb_out.push(0);
+            hb_out.set(0);
             n = n - 1;  // restore n
         }
 
-        for (uint64_t i = 0; i != n; ++i, ++begin) {
-            auto v = *begin;
-            if constexpr (encode_prefix_sum) {
-                v = v + last;             // prefix sum
-            } else if (i and v < last) {  // check the order
-#if PTHASH_ENABLE_INSTRUMENTATION
-                std::cerr << "error at " << i << "/" << n << ":\n";
-                std::cerr << "last " << last << "\n";
-                std::cerr << "current " << v << "\n";
-#endif
-                throw std::runtime_error("sequence is not sorted");
+        /*
+            Straight-line loop body: the sortedness check accumulates into a
+            flag tested once after the loop instead of throwing from an
+            unpredictable per-element branch, and the l == 0 case is
+            unswitched so the compiler can pipeline the two writers.
+        */
+        uint64_t sorted_violation = 0;
+        auto fill = [&](auto has_low_bits) {
+            for (uint64_t i = 0; i != n; ++i, ++begin) {
+                auto v = *begin;
+                if constexpr (encode_prefix_sum) {
+                    v = v + last;  // prefix sum
+                } else {
+                    sorted_violation |= uint64_t(v < last);
+                }
+                if constexpr (decltype(has_low_bits)::value) {
+                    lb_out.push(v & low_mask);
+                }
+                hb_out.set((v >> l) + i + encode_prefix_sum);
+                last = v;
             }
-            if (l) cvb_low_bits.set(i + encode_prefix_sum, v & low_mask);
-            bvb_high_bits.set((v >> l) + i + encode_prefix_sum, 1);
-            last = v;
+        };
+        if (l) {
+            fill(std::true_type{});
+        } else {
+            fill(std::false_type{});
+        }
+        hb_out.flush();
+        lb_out.flush();
+        if constexpr (!encode_prefix_sum) {
+            if (sorted_violation) throw std::runtime_error("sequence is not sorted");
         }
 
         m_back = last;
+        m_l = l;
+        m_low_mask = low_mask;
         bvb_high_bits.build(m_high_bits);
         cvb_low_bits.build(m_low_bits);
         m_high_bits_d1.build(m_high_bits);
         if constexpr (index_zeros) m_high_bits_d0.build(m_high_bits);
     }
 
+    /*
+        Sequential iterator over the encoded values. The cursor state is kept
+        flat - a pending-ones word into the high bits and a running bit offset
+        into the low bits - instead of embedding the generic bit_vector and
+        compact_vector iterators, so that next() is a TZCNT/BLSR step plus one
+        shift-and-mask extraction over state that fits in a single struct.
+    */
     struct iterator {
-        iterator() : m_ef(nullptr), m_pos(0), m_l(0), m_val(0) {}
+        iterator()
+            : m_ef(nullptr)
+            , m_pos(0)
+            , m_l(0)
+            , m_val(0)
+            , m_hb_words(nullptr)
+            , m_hb_buf(0)
+            , m_hb_word_idx(0)
+            , m_lb_words(nullptr)
+            , m_lb_bit(0)
+            , m_low_mask(0) {}
 
         iterator(elias_fano const* ef, uint64_t pos = 0)
             : m_ef(ef)
             , m_pos(pos)
-            , m_l(ef->m_low_bits.width())
-            , m_val(0)  //
+            , m_l(ef->m_l)
+            , m_val(0)
+            , m_hb_words(nullptr)
+            , m_hb_buf(0)
+            , m_hb_word_idx(0)
+            , m_lb_words(nullptr)
+            , m_lb_bit(0)
+            , m_low_mask(0)  //
         {
             if (!has_next() or m_ef->m_high_bits_d1.num_positions() == 0) return;
             assert(m_l < 64);
+            // overlap the low-bits miss with the select walk below
+            __builtin_prefetch(m_ef->m_low_bits.data().data() + ((m_pos * m_l) >> 6));
             uint64_t begin = m_ef->m_high_bits_d1.select(m_ef->m_high_bits, m_pos);
-            m_high_bits_it = m_ef->m_high_bits.get_iterator_at(begin);
-            m_low_bits_it = m_ef->m_low_bits.get_iterator_at(m_pos);
+            m_hb_words = m_ef->m_high_bits.data().data();
+            m_hb_word_idx = begin >> 6;
+            m_hb_buf = m_hb_words[m_hb_word_idx] & (uint64_t(-1) << (begin & 63));
+            m_lb_words = m_ef->m_low_bits.data().data();
+            m_lb_bit = m_pos * m_l;
+            m_low_mask = m_ef->m_low_mask;
             read_next_value();
         }
 
-        bool has_next() const { return m_pos < m_ef->size(); }
+        [[gnu::always_inline]] inline bool has_next() const { return m_pos < m_ef->size(); }
         bool has_prev() const { return m_pos > 0; }
         uint64_t value() const { return m_val; }
         uint64_t position() const { return m_pos; }
@@ -129,13 +228,25 @@ struct elias_fano {
             assert(m_pos > 0);
             uint64_t pos = m_pos - 1;
             /*
-                Read_next_value() sets the state ahead of 1 position,
-                hence must go back by 2 to get previous value.
+                Read_next_value() sets the state ahead of 1 position: the one
+                for m_pos is already consumed, so the pos-th one is the set
+                bit right below it. m_hb_buf holds the pending (unconsumed)
+                ones of the current word, hence XOR-ing it away leaves the
+                ones at or below the current value's one.
             */
-            assert(m_high_bits_it.position() >= 2);
-            uint64_t high = m_high_bits_it.prev(m_high_bits_it.position() - 2);
+            uint64_t block = m_hb_word_idx;
+            uint64_t word = m_hb_words[block] ^ m_hb_buf;
+            assert(word != 0);  // the one for m_pos lives in this word
+            word ^= uint64_t(1) << util::msbll(word);  // drop it
+            uint64_t msb = 0;
+            while (!util::msbll(word, msb)) {
+                assert(block > 0);
+                word = m_hb_words[--block];
+            }
+            uint64_t high = (block << 6) + msb;
             assert(high == m_ef->m_high_bits_d1.select(m_ef->m_high_bits, pos));
-            uint64_t low = *(m_low_bits_it - 2);
+            uint64_t low = 0;
+            if (m_l) low = read_low_bits(m_lb_bit - 2 * m_l);
             return (((high - pos) << m_l) | low);
         }
 
@@ -144,39 +255,100 @@ struct elias_fano {
         uint64_t m_pos;
         uint64_t m_l;
         uint64_t m_val;
-        bit_vector::iterator m_high_bits_it;
-        compact_vector::iterator m_low_bits_it;
+        uint64_t const* m_hb_words;
+        uint64_t m_hb_buf;       // pending ones of the current high-bits word
+        uint64_t m_hb_word_idx;  // word holding the one consumed for m_val
+        uint64_t const* m_lb_words;
+        uint64_t m_lb_bit;  // bit offset of the next value's low bits
+        uint64_t m_low_mask;
+
+        /*
+            Branchless extraction, as in compact_vector: load the 16 bytes
+            covering the element at its byte address and funnel-shift by the
+            residual 0..7 bit offset (compiles to two loads + shrd). The
+            compact_vector builder pads its words so the load is in bounds;
+            no data-dependent branch on whether the element straddles a
+            word boundary.
+        */
+        [[gnu::always_inline]] inline uint64_t read_low_bits(uint64_t bit) const {
+            uint8_t const* p = reinterpret_cast<uint8_t const*>(m_lb_words) + (bit >> 3);
+            __uint128_t word;
+            memcpy(&word, p, 16);
+            return static_cast<uint64_t>(word >> (bit & 7)) & m_low_mask;
+        }
 
-        void read_next_value() {
+        [[gnu::always_inline]] inline void read_next_value() {
             assert(m_pos < m_ef->size());
-            uint64_t high = m_high_bits_it.next();
+            while (m_hb_buf == 0) m_hb_buf = m_hb_words[++m_hb_word_idx];
+            uint64_t high = (m_hb_word_idx << 6) + util::lsbll(m_hb_buf);
+            m_hb_buf &= m_hb_buf - 1;
             assert(high == m_ef->m_high_bits_d1.select(m_ef->m_high_bits, m_pos));
-            uint64_t low = *m_low_bits_it;
+            uint64_t low = 0;
+            if (m_l) {
+                low = read_low_bits(m_lb_bit);
+                m_lb_bit += m_l;
+            }
             m_val = (((high - m_pos) << m_l) | low);
-            ++m_low_bits_it;
         }
     };
 
     iterator get_iterator_at(uint64_t pos) const { return iterator(this, pos); }
     iterator begin() const { return get_iterator_at(0); }
 
-    uint64_t access(uint64_t i) const {
-        PTHASH_LOG("[P8.EF_ACCESS] ENTER access(i=%llu)\n", (unsigned long long)i);
+    /*
+        Start fetching the lines access(i) will read (select inventories and
+        the low-bits word) without resolving anything; lets callers overlap
+        the access miss chain with work preceding the actual access(i) call.
+    */
+    inline void prefetch(uint64_t i) const {
+        m_high_bits_d1.prefetch(i);
+        if (m_l) __builtin_prefetch(m_low_bits.data().data() + ((i * m_l) >> 6));
+    }
+
+    [[gnu::always_inline]] inline uint64_t access(uint64_t i) const {
         assert(i < size());
-        PTHASH_LOG("[P8.EF_ACCESS]   Calling m_high_bits_d1.select(m_high_bits, i=%llu)...\n", (unsigned long long)i);
-        uint64_t select_result = m_high_bits_d1.select(m_high_bits, i);
-        PTHASH_LOG("[P8.EF_ACCESS]   m_high_bits_d1.select returned: %llu\n", (unsigned long long)select_result);
-        uint64_t high_val = select_result - i;
-        PTHASH_LOG("[P8.EF_ACCESS]   Calculated high_val = select_result - i = %llu\n", (unsigned long long)high_val);
-        uint64_t width = m_low_bits.width();
-        PTHASH_LOG("[P8.EF_ACCESS]   m_low_bits.width() = %llu\n", (unsigned long long)width);
-        PTHASH_LOG("[P8.EF_ACCESS]   Calling m_low_bits.access(i=%llu)...\n", (unsigned long long)i);
-        uint64_t low_val = m_low_bits.access(i);
-        PTHASH_LOG("[P8.EF_ACCESS]   m_low_bits.access returned: %llu\n", (unsigned long long)low_val);
-        uint64_t final_pos = (high_val << width) | low_val;
-        PTHASH_LOG("[P8.EF_ACCESS] EXIT access -> (high_val << width) | low_val = (%llu << %llu) | %llu = %llu\n",
-                (unsigned long long)high_val, (unsigned long long)width, (unsigned long long)low_val, (unsigned long long)final_pos);
-        return final_pos;
+        /*
+            The select walk and the low-bits load miss independently;
+            request the low-bits line first so both stalls overlap
+            instead of serializing.
+        */
+        uint64_t width = m_l;
+        // dense sequences (universe <= n) store no low bits at all
+        if (width == 0) return m_high_bits_d1.select(m_high_bits, i) - i;
+        __builtin_prefetch(m_low_bits.data().data() + ((i * width) >> 6));
+        uint64_t high_val = m_high_bits_d1.select(m_high_bits, i) - i;
+        return (high_val << width) | m_low_bits.access(i);
+    }
+
+    /*
+        Batched access: out[k] = access(is[k]) for all 0 <= k < n.
+        The select chains go through darray::select_batch, which pipelines
+        its inventory prefetches across the batch (and collapses runs of
+        consecutive ranks into a linear sweep); the low-bits lines are
+        prefetched a fixed distance ahead while the results are combined,
+        so the independent misses of many queries overlap instead of
+        stalling one query at a time.
+    */
+    void access_many(uint64_t const* is, uint64_t n, uint64_t* out) const {
+        static constexpr uint64_t lookahead = 8;
+        uint64_t width = m_l;
+        uint64_t const* low_words = m_low_bits.data().data();
+        m_high_bits_d1.select_batch(m_high_bits, is, n, out);
+        // as in access(): dense sequences (universe <= n) store no low bits,
+        // so skip the combine loop and its pointless low-bits prefetches
+        if (width == 0) {
+            for (uint64_t k = 0; k != n; ++k) out[k] -= is[k];
+            return;
+        }
+        for (uint64_t k = 0; k != n && k != lookahead; ++k) {
+            __builtin_prefetch(low_words + ((is[k] * width) >> 6));
+        }
+        for (uint64_t k = 0; k != n; ++k) {
+            if (k + lookahead < n) {
+                __builtin_prefetch(low_words + ((is[k + lookahead] * width) >> 6));
+            }
+            out[k] = ((out[k] - is[k]) << width) | m_low_bits.access(is[k]);
+        }
     }
 
     /*
@@ -191,12 +363,15 @@ struct elias_fano {
             diff(3) = V[3] = V'[4] - V'[3] = 11-10 = 1
             diff(4) = V[4] = V'[5] - V'[4] = 27-11 = 16
     */
-    uint64_t diff(uint64_t i) const {
+    [[gnu::always_inline]] inline uint64_t diff(uint64_t i) const {
         assert(i < size() && encode_prefix_sum);
+        // as in access(): overlap the low-bits misses with the select walk
+        __builtin_prefetch(m_low_bits.data().data() + ((i * m_l) >> 6));
+        __builtin_prefetch(m_low_bits.data().data() + (((i + 1) * m_l) >> 6));
+        uint64_t pos = m_high_bits_d1.select(m_high_bits, i);
         uint64_t low1 = m_low_bits.access(i);
         uint64_t low2 = m_low_bits.access(i + 1);
-        uint64_t l = m_low_bits.width();
-        uint64_t pos = m_high_bits_d1.select(m_high_bits, i);
+        uint64_t l = m_l;
         uint64_t h1 = pos - i;
         uint64_t h2 = m_high_bits.get_iterator_at(pos + 1).next() - i - 1;
         uint64_t val1 = (h1 << l) | low1;
@@ -204,6 +379,30 @@ struct elias_fano {
         return val2 - val1;
     }
 
+    /*
+        Batched form of diff(): out[k] = diff(i + k) for all 0 <= k < n.
+        A single select positions the iterator, then each element costs a
+        TZCNT step over the high bits and one low-bits extraction, instead
+        of a fresh select plus two random low-bits accesses per call; the
+        upcoming low-bits lines are prefetched a fixed distance ahead.
+    */
+    void diff_range(uint64_t i, uint64_t n, uint64_t* out) const {
+        assert(i + n < size() && encode_prefix_sum);
+        if (n == 0) return;
+        static constexpr uint64_t lookahead = 8;
+        uint64_t width = m_l;
+        uint64_t const* low_words = m_low_bits.data().data();
+        auto it = get_iterator_at(i);
+        uint64_t prev = it.value();
+        for (uint64_t k = 0; k != n; ++k) {
+            __builtin_prefetch(low_words + (((i + k + lookahead) * width) >> 6));
+            it.next();
+            uint64_t val = it.value();
+            out[k] = val - prev;
+            prev = val;
+        }
+    }
+
     struct return_value {
         uint64_t pos;
         uint64_t val;
@@ -298,7 +497,7 @@ struct elias_fano {
     }
 
     uint64_t num_bytes() const {
-        return sizeof(m_back) + m_high_bits.num_bytes() + m_high_bits_d1.num_bytes() +
+        return sizeof(m_back) + sizeof(m_l) + sizeof(m_low_mask) + m_high_bits.num_bytes() + m_high_bits_d1.num_bytes() +
                m_high_bits_d0.num_bytes() + m_low_bits.num_bytes();
     }
 
@@ -320,13 +519,16 @@ struct elias_fano {
         return m_high_bits_d1;
     }
     
-    const DArray0& get_high_bits_d0() const {
+    auto const& get_high_bits_d0() const {
+        static_assert(index_zeros, "no zeros index when index_zeros = false");
         return m_high_bits_d0;
     }
     // ========= END AGGRESSIVE GETTERS =========
 
     void swap(elias_fano& other) {
         std::swap(m_back, other.m_back);
+        std::swap(m_l, other.m_l);
+        std::swap(m_low_mask, other.m_low_mask);
         m_high_bits.swap(other.m_high_bits);
         m_high_bits_d1.swap(other.m_high_bits_d1);
         m_high_bits_d0.swap(other.m_high_bits_d0);
@@ -345,36 +547,40 @@ struct elias_fano {
 
 private:
     uint64_t m_back;
+    /* cached m_low_bits.width() and its mask: saves a dependent load into
+       the compact_vector header on every query */
+    uint64_t m_l;
+    uint64_t m_low_mask;
     bit_vector m_high_bits;
     DArray1 m_high_bits_d1;
-    DArray0 m_high_bits_d0;
+    [[no_unique_address]] std::conditional_t<index_zeros, DArray0, detail::no_darray>
+        m_high_bits_d0;
     compact_vector m_low_bits;
 
     template <typename Visitor, typename T>
     static void visit_impl(Visitor& visitor, T&& t) {
-        //PTHASH_LOG("[P3.EF] ENTER elias_fano::visit_impl\n");
+#if PTHASH_ENABLE_INSTRUMENTATION
+        /*
+            Instrumented builds wrap the darray visits in prefix contexts so
+            their log lines are attributable; release builds get the flat
+            five-visit sequence below with no per-field scaffolding.
+        */
         visitor.visit(t.m_back);
+        visitor.visit(t.m_l);
+        visitor.visit(t.m_low_mask);
         visitor.visit(t.m_high_bits);
-
-        // *** ADDED CONTEXT LOGGING FOR DARRAY1 ***
         PTHASH_LOG("[EF_SAVE] Visiting m_high_bits_d1 START\n");
-        { // Scope for prefix setter
+        {
             instrumentation_context::prefix_setter ctx("[DARRAY1_SAVE]");
             visitor.visit(t.m_high_bits_d1);
         }
         PTHASH_LOG("[EF_SAVE] Visiting m_high_bits_d1 END\n");
-        // *** END CONTEXT LOGGING ***
-
-        // *** ADDED CONTEXT LOGGING FOR DARRAY0 ***
         PTHASH_LOG("[EF_SAVE] Visiting m_high_bits_d0 START\n");
-        { // Scope for prefix setter
+        {
             instrumentation_context::prefix_setter ctx("[DARRAY0_SAVE]");
             visitor.visit(t.m_high_bits_d0);
         }
         PTHASH_LOG("[EF_SAVE] Visiting m_high_bits_d0 END\n");
-        // *** END CONTEXT LOGGING ***
-
-        // Log m_low_bits (as before)
         PTHASH_LOG("[CV_LOWBITS_SAVE] Pre-Save State: Size=%llu, Width=%llu, Mask=0x%llX, DataSize=%lu\n",
             (unsigned long long)t.m_low_bits.size(),
             (unsigned long long)t.m_low_bits.width(),
@@ -382,7 +588,15 @@ private:
             (unsigned long)t.m_low_bits.data().size());
         visitor.visit(t.m_low_bits);
         PTHASH_LOG("[CV_LOWBITS_SAVE] Finished visiting m_low_bits\n");
-        //PTHASH_LOG("[P3.EF] EXIT elias_fano::visit_impl\n");
+#else
+        visitor.visit(t.m_back);
+        visitor.visit(t.m_l);
+        visitor.visit(t.m_low_mask);
+        visitor.visit(t.m_high_bits);
+        visitor.visit(t.m_high_bits_d1);
+        visitor.visit(t.m_high_bits_d0);
+        visitor.visit(t.m_low_bits);
+#endif
     }
 
     /*
@@ -395,25 +609,53 @@ private:
 
         if (x > back()) return {{size() - 1, back()}, iterator()};
 
-        uint64_t h_x = x >> m_low_bits.width();
+        uint64_t h_x = x >> m_l;
         uint64_t begin = h_x ? m_high_bits_d0.select(m_high_bits, h_x - 1) - h_x + 1 : 0;
         assert(begin < size());
 
-        // uint64_t end = m_high_bits_d0.select(m_high_bits, h_x) - h_x;
-        // assert(end <= size());
-        // assert(begin <= end);
-        // return binary search for x in [begin, end)
+        /*
+            The h_x-th zero closes bucket h_x, so end is the first position
+            whose high part exceeds h_x. When the bucket holds many elements
+            (heavy duplication), binary search its low bits - sorted, since
+            the high prefix is fixed - instead of scanning: if no low in
+            [begin, end) reaches the low part of x, the answer is position
+            end itself, whose high part is > h_x and hence whose value >= x.
+        */
+        static constexpr uint64_t binary_search_threshold = 16;
+        uint64_t end = m_high_bits_d0.select(m_high_bits, h_x) - h_x;
+        assert(end <= size());
+        assert(begin <= end);
+        if (end - begin > binary_search_threshold) {
+            uint64_t x_low = x & m_low_mask;
+            uint64_t lo = begin, hi = end;
+            while (lo < hi) {
+                uint64_t mid = lo + ((hi - lo) >> 1);
+                if (m_low_bits.access(mid) < x_low) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            assert(lo < size());
+            auto it = get_iterator_at(lo);
+            assert(it.value() >= x);
+            return {{lo, it.value()}, it};
+        }
 
         auto it = get_iterator_at(begin);
         uint64_t pos = begin;
         uint64_t val = it.value();
+        /*
+            Scan one element at a time only for a few steps: runs inside a
+            high bucket are short on average, and the iterator is already
+            positioned (no extra select when the answer is nearby).
+            Note: no need for bound checking here because x <= back(),
+            hence pos cannot be equal to size().
+        */
+        uint64_t scalar_budget = 4;
         while (val < x) {
+            if (scalar_budget-- == 0) return next_geq_scan_blocks(x, pos, val);
             ++pos;
-            /*
-                Note: no need for bound checking here
-                because x <= back(), hence pos cannot
-                be equal to size().
-            */
             it.next();
             val = it.value();
         }
@@ -425,6 +667,42 @@ private:
         return {{pos, val}, it};
     }
 
+    /*
+        Continuation of next_geq_leftmost for long runs: decode blocks of
+        eight values at a time - the unary-coded highs with a raw TZCNT
+        walk over the high-bits words, the packed lows in one shot through
+        compact_vector::decode_range (AVX2 byte-granular gather) - instead
+        of paying the per-element iterator machinery. (pos, val) is the
+        current element with val < x; one select re-positions the returned
+        iterator once the answer is found, amortized over the long scan.
+    */
+    std::pair<return_value, iterator> next_geq_scan_blocks(const uint64_t x, uint64_t pos,
+                                                           uint64_t val) const {
+        uint64_t l = m_l;
+        uint64_t const* hw = m_high_bits.data().data();
+        uint64_t hp = (val >> l) + pos;  // position in high_bits of the pos-th one
+        uint64_t word_idx = hp >> 6;
+        uint64_t word = hw[word_idx] & (uint64_t(-1) << (hp & 63));
+        word &= word - 1;  // drop the current one
+        uint64_t lows[8];
+        while (true) {
+            uint64_t cnt = std::min<uint64_t>(8, size() - (pos + 1));
+            assert(cnt > 0);  // x <= back(), so the answer is ahead
+            m_low_bits.decode_range(pos + 1, cnt, lows);
+            for (uint64_t j = 0; j != cnt; ++j) {
+                while (word == 0) word = hw[++word_idx];
+                uint64_t one_pos = (word_idx << 6) + util::lsbll(word);
+                word &= word - 1;
+                ++pos;
+                val = ((one_pos - pos) << l) | lows[j];
+                if (val >= x) {
+                    assert(val == access(pos));
+                    return {{pos, val}, get_iterator_at(pos)};
+                }
+            }
+        }
+    }
+
     /*
         Return [position,value] of the rightmost smallest element that is >= x.
         Return [size()-1,back()] if x >= back().
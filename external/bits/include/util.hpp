@@ -7,6 +7,10 @@
 #include <immintrin.h>
 #endif
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace bits::util {
 
 /*
@@ -97,10 +101,10 @@ static inline uint64_t select_in_word(uint64_t word, uint64_t i) {
     s -= ((t - k) & 256) >> 8;
     return s - 1;
 #else
-    uint64_t k = 1ULL << i;
-    asm("pdep %[word], %[mask], %[word]" : [ word ] "+r"(word) : [ mask ] "r"(k));
-    asm("tzcnt %[bit], %[index]" : [ index ] "=r"(k) : [ bit ] "g"(word) : "cc");
-    return k;
+    // PDEP deposits the single bit of rank i onto the i-th set bit of word;
+    // TZCNT then reads off its position. Intrinsics instead of inline asm so
+    // the compiler can schedule and hoist freely.
+    return _tzcnt_u64(_pdep_u64(1ULL << i, word));
 #endif
 }
 
@@ -72,146 +72,68 @@ struct single_phf  //
     }
 
     template <typename T>
-    uint64_t operator()(T const& key) const {
-        PTHASH_LOG("[P4] ENTER single_phf::operator()\n");
-        PTHASH_LOG("[P4] Hasher::hash(key, m_seed=%llu) ...\n", (unsigned long long)m_seed);
-        
-        // Use if constexpr to handle different key types safely
+    PTHASH_PURE [[gnu::hot]] [[gnu::always_inline]] inline uint64_t operator()(T const& key) const {
         if constexpr (std::is_integral_v<T>) {
             PTHASH_LOG("[P8_LOOKUP_CPP] === Processing Key: %llu ===\n", (unsigned long long)key);
         } else {
             PTHASH_LOG("[P8_LOOKUP_CPP] === Processing Key (non-integer) ===\n");
         }
-        
         auto hash = Hasher::hash(key, m_seed);
-        PTHASH_LOG("[P4]   ... returned hash={%llu, %llu}\n", (unsigned long long)hash.first(), (unsigned long long)hash.second());
-        PTHASH_LOG("[P4] Calling position(hash)...\n");
         uint64_t final_pos = position(hash);
-        PTHASH_LOG("[P4] EXIT single_phf::operator() -> %llu\n", (unsigned long long)final_pos);
-        
-        // Use if constexpr to handle different key types safely
         if constexpr (std::is_integral_v<T>) {
             PTHASH_LOG("[P8_LOOKUP_CPP] === Finished Key: %llu ===\n", (unsigned long long)key);
         } else {
             PTHASH_LOG("[P8_LOOKUP_CPP] === Finished Key (non-integer) ===\n");
         }
-        
         return final_pos;
     }
 
-    uint64_t position(typename Hasher::hash_type hash) const {
-        PTHASH_LOG("[P4] ENTER single_phf::position(hash={%llu, %llu})\n", (unsigned long long)hash.first(), (unsigned long long)hash.second());
-
-        PTHASH_LOG("[P4] Calling m_bucketer.bucket(hash.first()=%llu)...\n", (unsigned long long)hash.first());
-        const uint64_t bucket_id = m_bucketer.bucket(hash.first());
-        PTHASH_LOG("[P4] m_bucketer.bucket returned bucket_id: %llu\n", (unsigned long long)bucket_id);
-        PTHASH_LOG("[P8_LOOKUP_CPP]   bucket_id: %llu\n", (unsigned long long)bucket_id);
-
-        PTHASH_LOG("[P4] Calling m_pilots.access(bucket=%llu)...\n", (unsigned long long)bucket_id);
-        const uint64_t pilot = m_pilots.access(bucket_id);
-        PTHASH_LOG("[P4] m_pilots.access returned pilot: %llu\n", (unsigned long long)pilot);
-        PTHASH_LOG("[P8_LOOKUP_CPP]   pilot: %llu\n", (unsigned long long)pilot);
+    PTHASH_PURE [[gnu::hot]] [[gnu::always_inline]] inline uint64_t position(
+        typename Hasher::hash_type hash) const {
+        return position_in_bucket(hash, m_bucketer.bucket(hash.first()));
+    }
 
-        uint64_t p = 0;
-        if constexpr (Search == pthash_search_type::xor_displacement) {
-            PTHASH_LOG("[P4] Using XOR displacement...\n");
-            PTHASH_LOG("[P4] Calculating hashed_pilot = default_hash64(pilot=%llu, m_seed=%llu)...\n", (unsigned long long)pilot, (unsigned long long)m_seed);
-            const uint64_t hashed_pilot = default_hash64(pilot, m_seed);
-            PTHASH_LOG("[P4]   hashed_pilot = %llu\n", (unsigned long long)hashed_pilot);
-            uint64_t xor_result = hash.second() ^ hashed_pilot;
-            PTHASH_LOG("[P4] Calculating p = fastmod::fastmod_u64(val=%llu ^ %llu = %llu, M=m_M_128, N=m_table_size=%llu)...\n",
-                    (unsigned long long)hash.second(), (unsigned long long)hashed_pilot, (unsigned long long)xor_result, (unsigned long long)m_table_size);
-            p = fastmod::fastmod_u64(xor_result, m_M_128, m_table_size);
-            PTHASH_LOG("[P4]   Calculated p = %llu\n", (unsigned long long)p);
-            PTHASH_LOG("[P8_LOOKUP_CPP]   h1: %llu\n", (unsigned long long)hash.first());
-            PTHASH_LOG("[P8_LOOKUP_CPP]   h2: %llu\n", (unsigned long long)hash.second());
-            PTHASH_LOG("[P8_LOOKUP_CPP]   raw_pos (p): %llu\n", (unsigned long long)p);
-        } else {
-            // This path corresponds to the description, assuming ADD displacement is the `else`
-            PTHASH_LOG("[P4] Using ADD displacement...\n");
-            PTHASH_LOG("[P4] Calculating s = fastmod::fastdiv_u32(pilot=%llu, M=m_M_64)...\n", (unsigned long long)pilot);
-            const uint64_t s = fastmod::fastdiv_u32(pilot, m_M_64);
-            PTHASH_LOG("[P4]   s = %llu\n", (unsigned long long)s);
-            uint64_t sum_hash_s = hash.second() + s;
-            PTHASH_LOG("[P4] Calculating intermediate_hash = hash64(hash.second() + s = %llu + %llu = %llu).mix()...\n",
-                    (unsigned long long)hash.second(), (unsigned long long)s, (unsigned long long)sum_hash_s);
-            uint64_t intermediate_hash_mix = hash64(sum_hash_s).mix();
-            PTHASH_LOG("[P4]   intermediate_hash_mix = %llu\n", (unsigned long long)intermediate_hash_mix);
-            uint64_t shifted_mix = intermediate_hash_mix >> 33;
-            uint64_t sum_for_mod = shifted_mix + pilot;
-            PTHASH_LOG("[P4] Calculating p = fastmod::fastmod_u32(val=(intermediate_hash_mix >> 33) + pilot = (%llu >> 33) + %llu = %llu + %llu = %llu, M=m_M_64, N=m_table_size=%llu)...\n",
-                    (unsigned long long)intermediate_hash_mix, (unsigned long long)pilot, (unsigned long long)shifted_mix, (unsigned long long)pilot, (unsigned long long)sum_for_mod, (unsigned long long)m_table_size);
-            p = fastmod::fastmod_u32(sum_for_mod, m_M_64, m_table_size);
-            PTHASH_LOG("[P4]   Calculated p = %llu\n", (unsigned long long)p);
-            PTHASH_LOG("[P8_LOOKUP_CPP]   h1: %llu\n", (unsigned long long)hash.first());
-            PTHASH_LOG("[P8_LOOKUP_CPP]   h2: %llu\n", (unsigned long long)hash.second());
-            PTHASH_LOG("[P8_LOOKUP_CPP]   raw_pos (p): %llu\n", (unsigned long long)p);
+    /*
+        Batched lookup: out[k] = operator()(keys[k]) for all 0 <= k < n.
+        Each lookup chains an unpredictable pilot fetch that misses cache on
+        large functions; hashing and bucketing run a fixed distance ahead of
+        the pilot accesses so the misses of many keys overlap instead of
+        serializing, in the same shape as the batched Elias-Fano decode
+        paths. Single-key operator() remains for point lookups.
+    */
+    template <typename Iterator>
+    void lookup_batch(Iterator keys, uint64_t n, uint64_t* out) const {
+        static constexpr uint64_t lookahead = 8;
+        const lookup_ctx ctx = make_context();
+        typename Hasher::hash_type hashes[lookahead];
+        uint64_t buckets[lookahead];
+        uint64_t staged = 0;
+        for (; staged != n && staged != lookahead; ++staged, ++keys) {
+            uint64_t slot = staged & (lookahead - 1);
+            hashes[slot] = Hasher::hash(*keys, ctx.seed);
+            buckets[slot] = ctx.bucketer->bucket(hashes[slot].first());
+            prefetch_access(*ctx.pilots, buckets[slot]);
         }
-
-        // Only define and use num_keys_val when PTHASH_ENABLE_INSTRUMENTATION is enabled
-        #if PTHASH_ENABLE_INSTRUMENTATION
-        uint64_t num_keys_val = num_keys();
-        PTHASH_LOG("[P8_LOOKUP_CPP]   num_keys: %llu\n", (unsigned long long)num_keys_val);
-        PTHASH_LOG("[P8_LOOKUP_CPP]   Checking condition: p (%llu) < num_keys (%llu)\n", 
-                (unsigned long long)p, (unsigned long long)num_keys_val);
-        #endif
-        
-        uint64_t final_index;
-
-        if constexpr (Minimal) {
-            PTHASH_LOG("[P4] Minimal=true. Checking if p (%llu) < num_keys() (%llu)...\n", (unsigned long long)p, (unsigned long long)num_keys());
-            if (PTHASH_LIKELY(p < num_keys())) {
-                PTHASH_LOG("[P4]   p < num_keys(). Returning p.\n");
-                final_index = p;
-                PTHASH_LOG("[P8_LOOKUP_CPP]   Condition TRUE. Final index = p = %llu\n", 
-                        (unsigned long long)final_index);
-                    
-                PTHASH_LOG("[P4] EXIT single_phf::position -> %llu\n", (unsigned long long)p);
-                
-                PTHASH_LOG("[P8_LOOKUP_CPP]   Final Mapped Index: %llu\n", (unsigned long long)final_index);
-                
-                return p;
-            } else {
-                 PTHASH_LOG("[P4]   p >= num_keys()...\n");
-                 uint64_t index = p - num_keys();
-                 PTHASH_LOG("[P8.PHF_POS] Minimal=true, p (%llu) >= num_keys (%llu). Calculating index = %llu - %llu = %llu\n",
-                        (unsigned long long)p, (unsigned long long)num_keys(), (unsigned long long)p, (unsigned long long)num_keys(), (unsigned long long)index);
-                 
-                 PTHASH_LOG("[P8_LOOKUP_CPP]   Condition FALSE. Calling m_free_slots.access(p - num_keys = %llu)\n", 
-                        (unsigned long long)index);
-                    
-                 PTHASH_LOG("[P4]   ... Calling m_free_slots.access(index=%llu)...\n", (unsigned long long)index);
-                 
-                 final_index = m_free_slots.access(index);
-                 
-                 PTHASH_LOG("[P8.PHF_POS] m_free_slots.access(%llu) returned final_mapped_index: %llu\n",
-                        (unsigned long long)index, (unsigned long long)final_index);
-                 PTHASH_LOG("[P4]   m_free_slots.access returned final_pos: %llu\n", (unsigned long long)final_index);
-                 
-                 PTHASH_LOG("[P8_LOOKUP_CPP]   m_free_slots.access(%llu) returned final_index: %llu\n", 
-                        (unsigned long long)index, (unsigned long long)final_index);
-                 
-                 PTHASH_LOG("[P4] EXIT single_phf::position -> %llu\n", (unsigned long long)final_index);
-                 
-                 PTHASH_LOG("[P8_LOOKUP_CPP]   Final Mapped Index: %llu\n", (unsigned long long)final_index);
-                 
-                 return final_index;
+        for (uint64_t k = 0; k != n; ++k) {
+            uint64_t slot = k & (lookahead - 1);
+            auto hash = hashes[slot];
+            uint64_t bucket_id = buckets[slot];
+            if (staged != n) {
+                hashes[slot] = Hasher::hash(*keys, ctx.seed);
+                buckets[slot] = ctx.bucketer->bucket(hashes[slot].first());
+                prefetch_access(*ctx.pilots, buckets[slot]);
+                ++staged;
+                ++keys;
             }
-        } else {
-            PTHASH_LOG("[P4] Minimal=false. Returning p.\n");
-            
-            final_index = p;
-            PTHASH_LOG("[P8_LOOKUP_CPP]   Non-minimal mode. Final index = p = %llu\n", 
-                    (unsigned long long)final_index);
-                    
-            PTHASH_LOG("[P4] EXIT single_phf::position -> %llu\n", (unsigned long long)p);
-            
-            PTHASH_LOG("[P8_LOOKUP_CPP]   Final Mapped Index: %llu\n", (unsigned long long)final_index);
-            
-            return p;
+            out[k] = position_in_bucket(ctx, hash, bucket_id);
         }
     }
 
+    PTHASH_PURE [[gnu::hot]] [[gnu::always_inline]] inline uint64_t position_in_bucket(
+        typename Hasher::hash_type hash, const uint64_t bucket_id) const {
+        return position_in_bucket(make_context(), hash, bucket_id);
+    }
+
     uint64_t num_bits_for_pilots() const {
         return 8 * (sizeof(m_seed) + sizeof(m_num_keys) + sizeof(m_table_size) + sizeof(m_M_64) +
                     sizeof(m_M_128)) +
@@ -272,22 +194,10 @@ struct single_phf  //
     }
 
     // Added for detailed sample intermediate output
-    uint64_t position_raw(typename Hasher::hash_type hash) const {
+    PTHASH_PURE [[gnu::always_inline]] inline uint64_t position_raw(
+        typename Hasher::hash_type hash) const {
         const uint64_t bucket = m_bucketer.bucket(hash.first());
-        const uint64_t pilot = m_pilots.access(bucket);
-
-        uint64_t p = 0;
-        if constexpr (Search == pthash_search_type::xor_displacement) {
-            /* xor displacement */
-            const uint64_t hashed_pilot = default_hash64(pilot, m_seed);
-            p = fastmod::fastmod_u64(hash.second() ^ hashed_pilot, m_M_128, m_table_size);
-        } else {
-            /* additive displacement */
-            const uint64_t s = fastmod::fastdiv_u32(pilot, m_M_64);
-            p = fastmod::fastmod_u32(((hash64(hash.second() + s).mix()) >> 33) + pilot, m_M_64,
-                                    m_table_size);
-        }
-        return p;
+        return displacement(make_context(), hash, m_pilots.access(bucket));
     }
     // ========= END AGGRESSIVE GETTERS =========
 
@@ -302,6 +212,98 @@ struct single_phf  //
     }
 
 private:
+    /*
+        Flat snapshot of everything a lookup touches. Batched lookups load it
+        once and keep the fastmod parameters in registers across the whole
+        batch instead of re-dereferencing `this` for every key.
+    */
+    struct lookup_ctx {
+        uint64_t seed;
+        uint64_t num_keys;
+        uint64_t table_size;
+        uint64_t M_64;
+        __uint128_t M_128;
+        Bucketer const* bucketer;
+        Encoder const* pilots;
+        bits::elias_fano<false, false> const* free_slots;
+    };
+
+    lookup_ctx make_context() const {
+        return {m_seed, m_num_keys,  m_table_size, m_M_64,
+                m_M_128, &m_bucketer, &m_pilots,    &m_free_slots};
+    }
+
+    /* Displacement kernel: resolves to exactly one of the two search arms at
+       instantiation time, and returning the slot as a const value (instead of
+       assigning into a zero-initialized local) keeps the def-use chain tight
+       for the remap compare below. */
+    [[gnu::always_inline]] static inline uint64_t displacement(
+        lookup_ctx const& ctx, typename Hasher::hash_type hash, const uint64_t pilot) {
+        if constexpr (Search == pthash_search_type::xor_displacement) {
+            const uint64_t hashed_pilot = default_hash64(pilot, ctx.seed);
+            return fastmod::fastmod_u64(hash.second() ^ hashed_pilot, ctx.M_128, ctx.table_size);
+        } else {
+            const uint64_t s = fastmod::fastdiv_u32(pilot, ctx.M_64);
+            return fastmod::fastmod_u32((hash64(hash.second() + s).mix() >> 33) + pilot, ctx.M_64,
+                                        ctx.table_size);
+        }
+    }
+
+    /*
+        The overflow remap fires on a small minority of keys; outlining it
+        keeps the straight-line lookup compact in the I-cache and gives
+        profile-driven layout a function boundary to push into a cold
+        section.
+    */
+    PTHASH_COLD static uint64_t remap_free_slot(lookup_ctx const& ctx, const uint64_t index) {
+        PTHASH_LOG("[P8_LOOKUP_CPP]   Condition FALSE. Calling m_free_slots.access(p - num_keys = %llu)\n",
+                   (unsigned long long)index);
+        uint64_t final_index = ctx.free_slots->access(index);
+        PTHASH_LOG("[P8_LOOKUP_CPP]   m_free_slots.access(%llu) returned final_index: %llu\n",
+                   (unsigned long long)index, (unsigned long long)final_index);
+        PTHASH_LOG("[P8_LOOKUP_CPP]   Final Mapped Index: %llu\n",
+                   (unsigned long long)final_index);
+        return final_index;
+    }
+
+    [[gnu::hot]] [[gnu::always_inline]] static inline uint64_t position_in_bucket(
+        lookup_ctx const& ctx, typename Hasher::hash_type hash, const uint64_t bucket_id) {
+        PTHASH_LOG("[P8_LOOKUP_CPP]   bucket_id: %llu\n", (unsigned long long)bucket_id);
+        const uint64_t pilot = ctx.pilots->access(bucket_id);
+        PTHASH_LOG("[P8_LOOKUP_CPP]   pilot: %llu\n", (unsigned long long)pilot);
+
+        const uint64_t p = displacement(ctx, hash, pilot);
+        PTHASH_LOG("[P8_LOOKUP_CPP]   h1: %llu\n", (unsigned long long)hash.first());
+        PTHASH_LOG("[P8_LOOKUP_CPP]   h2: %llu\n", (unsigned long long)hash.second());
+        PTHASH_LOG("[P8_LOOKUP_CPP]   raw_pos (p): %llu\n", (unsigned long long)p);
+        PTHASH_LOG("[P8_LOOKUP_CPP]   num_keys: %llu\n", (unsigned long long)ctx.num_keys);
+
+        if constexpr (Minimal) {
+            const uint64_t nk = ctx.num_keys;  // single load shared by compare and subtract
+            /*
+                Start the free-slot miss chain before the branch resolves: the
+                clamped index costs one cmov, and on the (mostly taken) fast
+                path the prefetch degenerates to a hit on the structure's
+                front lines. When the fallback does fire, its inventory and
+                low-bits lines are already in flight instead of waiting on a
+                mispredicted branch to retire.
+            */
+            ctx.free_slots->prefetch(p < nk ? 0 : p - nk);
+            if (PTHASH_LIKELY(p < nk)) {
+                PTHASH_LOG("[P8_LOOKUP_CPP]   Condition TRUE. Final index = p = %llu\n",
+                           (unsigned long long)p);
+                PTHASH_LOG("[P8_LOOKUP_CPP]   Final Mapped Index: %llu\n", (unsigned long long)p);
+                return p;
+            }
+            return remap_free_slot(ctx, p - nk);
+        } else {
+            PTHASH_LOG("[P8_LOOKUP_CPP]   Non-minimal mode. Final index = p = %llu\n",
+                       (unsigned long long)p);
+            PTHASH_LOG("[P8_LOOKUP_CPP]   Final Mapped Index: %llu\n", (unsigned long long)p);
+            return p;
+        }
+    }
+
     template <typename Visitor, typename T>
     static void visit_impl(Visitor& visitor, T&& t) {
         //PTHASH_LOG("[P3.PHF] ENTER single_phf::visit_impl\n");
@@ -332,10 +334,13 @@ private:
         return build_config;
     }
 
+    /* m_M_128 first: its 16-byte alignment would otherwise pad the struct,
+       and the alignas pins the 48 bytes of scalars a lookup touches to a
+       single L1 line instead of possibly straddling two. */
+    alignas(64) __uint128_t m_M_128;
     uint64_t m_seed;
     uint64_t m_num_keys;
     uint64_t m_table_size;
-    __uint128_t m_M_128;
     uint64_t m_M_64;
     Bucketer m_bucketer;
     Encoder m_pilots;
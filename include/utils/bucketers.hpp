@@ -27,7 +27,7 @@ struct table_bucketer {
         m_fulcrums[FULCS - 1] = num_buckets << 16;
     }
 
-    inline uint64_t bucket(const uint64_t hash) const {
+    [[gnu::hot]] [[gnu::always_inline]] inline uint64_t bucket(const uint64_t hash) const {
         uint64_t z = (hash & 0xFFFFFFFF) * uint64_t(FULCS - 1);
         uint64_t index = z >> 32;
         uint64_t part = z & 0xFFFFFFFF;
@@ -36,6 +36,12 @@ struct table_bucketer {
         return (v1 + v2) >> 16;
     }
 
+    /* bulk form: the interpolation is branchless, so the compiler unrolls
+       and pipelines the per-key multiplies across iterations */
+    void bucket_many(uint64_t const* hashes, const uint64_t n, uint64_t* out) const {
+        for (uint64_t i = 0; i != n; ++i) out[i] = bucket(hashes[i]);
+    }
+
     uint64_t num_buckets() const {
         return m_base.num_buckets();
     }
@@ -68,7 +74,9 @@ private:
 
     Bucketer m_base;
     static const uint64_t FULCS = 2048;
-    std::array<uint64_t, FULCS> m_fulcrums;
+    /* line-aligned so the table spans exactly 256 cache lines (and a
+       minimal number of pages) instead of straddling one extra at each end */
+    alignas(64) std::array<uint64_t, FULCS> m_fulcrums;
 };
 
 struct opt_bucketer {
@@ -96,7 +104,7 @@ struct opt_bucketer {
         return m_alpha_factor * baseFunc(m_alpha * normalized_hash);
     }
 
-    inline uint64_t bucket(const uint64_t hash) const {
+    [[gnu::hot]] [[gnu::always_inline]] inline uint64_t bucket(const uint64_t hash) const {
         double normalized_hash = double(hash) / double(~0ul);
         double normalized_bucket = bucketRelative(normalized_hash);
         uint64_t bucket_id =
@@ -105,6 +113,10 @@ struct opt_bucketer {
         return bucket_id;
     }
 
+    void bucket_many(uint64_t const* hashes, const uint64_t n, uint64_t* out) const {
+        for (uint64_t i = 0; i != n; ++i) out[i] = bucket(hashes[i]);
+    }
+
     uint64_t num_buckets() const {
         return m_num_buckets;
     }
@@ -163,36 +175,40 @@ struct skew_bucketer {
             m_num_sparse_buckets > 0 ? fastmod::computeM_u64(m_num_sparse_buckets) : 0;
     }
 
-    inline uint64_t bucket(uint64_t hash) const {
+    [[gnu::hot]] [[gnu::always_inline]] inline uint64_t bucket(uint64_t hash) const {
         PTHASH_LOG("[LP5] ENTER skew_bucketer::bucket(hash=h1=%llu)\n", (unsigned long long)hash);
-        static const uint64_t T = constants::a * static_cast<double>(UINT64_MAX);
-#ifdef PTHASH_INSTRUMENTED
-        static const double a_double = constants::a;
-        PTHASH_LOG("[LP5]   Threshold T = %llu (derived from %.17g)\n", (unsigned long long)T, a_double);
-#endif
-
-        uint64_t bucket_id;
-        if (hash < T) {
-            PTHASH_LOG("[LP5]   Comparing hash < T: %llu < %llu -> true (dense)\n", (unsigned long long)hash, (unsigned long long)T);
-            PTHASH_LOG("[LP5]   Using dense path.\n");
-            PTHASH_LOG("[LP5]   Calling fastmod_u64(hash=%llu, M_dense=0x%016llX%016llX, num_dense=%llu)\n",
-                    (unsigned long long)hash, (unsigned long long)(m_M_num_dense_buckets >> 64), (unsigned long long)m_M_num_dense_buckets, (unsigned long long)m_num_dense_buckets);
-            bucket_id = fastmod::fastmod_u64(hash, m_M_num_dense_buckets, m_num_dense_buckets);
-            PTHASH_LOG("[LP5]   fastmod_u64 result (dense) = %llu\n", (unsigned long long)bucket_id);
-        } else {
-            PTHASH_LOG("[LP5]   Comparing hash < T: %llu < %llu -> false (sparse)\n", (unsigned long long)hash, (unsigned long long)T);
-            PTHASH_LOG("[LP5]   Using sparse path.\n");
-            PTHASH_LOG("[LP5]   Calling fastmod_u64(hash=%llu, M_sparse=0x%016llX%016llX, num_sparse=%llu)\n",
-                     (unsigned long long)hash, (unsigned long long)(m_M_num_sparse_buckets >> 64), (unsigned long long)m_M_num_sparse_buckets, (unsigned long long)m_num_sparse_buckets);
-            uint64_t sparse_mod = fastmod::fastmod_u64(hash, m_M_num_sparse_buckets, m_num_sparse_buckets);
-            PTHASH_LOG("[LP5]   fastmod_u64 result (sparse_mod) = %llu\n", (unsigned long long)sparse_mod);
-            PTHASH_LOG("[LP5]   Adding num_dense = %llu\n", (unsigned long long)m_num_dense_buckets);
-            bucket_id = m_num_dense_buckets + sparse_mod;
-        }
+        /* constexpr, not a guarded static local: constants::a is a
+           compile-time constant, so T folds to an immediate with no
+           thread-safe-init check on the hot path */
+        constexpr uint64_t T = constants::a * static_cast<double>(UINT64_MAX);
+
+        /*
+            Branchless select: hash < T holds for a constants::a fraction of
+            uniformly distributed hashes, so the branch is inherently
+            unpredictable and mispredicts cost far more than the one extra
+            Barrett reduction of computing both arms (they are independent
+            and overlap in the pipeline). Either side may have zero buckets;
+            its reciprocal is 0 then and the reduction safely yields 0, which
+            the mask discards.
+        */
+        const uint64_t dense = fastmod::fastmod_u64(hash, m_M_num_dense_buckets, m_num_dense_buckets);
+        const uint64_t sparse =
+            m_num_dense_buckets +
+            fastmod::fastmod_u64(hash, m_M_num_sparse_buckets, m_num_sparse_buckets);
+        const uint64_t mask = -uint64_t(hash < T);
+        const uint64_t bucket_id = (dense & mask) | (sparse & ~mask);
+        PTHASH_LOG("[LP5]   hash < T: %llu < %llu -> %s\n", (unsigned long long)hash,
+                   (unsigned long long)T, (hash < T) ? "true (dense)" : "false (sparse)");
         PTHASH_LOG("[LP5] EXIT skew_bucketer::bucket -> bucket_id=%llu\n", (unsigned long long)bucket_id);
         return bucket_id;
     }
 
+    /* bulk form: with the select now branchless, consecutive keys have no
+       control dependence and their Barrett chains overlap when unrolled */
+    void bucket_many(uint64_t const* hashes, const uint64_t n, uint64_t* out) const {
+        for (uint64_t i = 0; i != n; ++i) out[i] = bucket(hashes[i]);
+    }
+
     uint64_t num_buckets() const {
         return m_num_dense_buckets + m_num_sparse_buckets;
     }
@@ -248,32 +264,39 @@ private:
         //fprintf(stderr, "[P3.SKEW] EXIT skew_bucketer::visit_impl\n");
     }
 
-    uint64_t m_num_dense_buckets, m_num_sparse_buckets;
+    /* the branchless bucket() reads all four fields every call; they total
+       48 bytes, so pinning the block to a line boundary guarantees one L1
+       line per call instead of two when the object straddles one */
+    alignas(64) uint64_t m_num_dense_buckets;
+    uint64_t m_num_sparse_buckets;
     __uint128_t m_M_num_dense_buckets, m_M_num_sparse_buckets;
 };
 
 struct range_bucketer {
-    range_bucketer() : m_num_buckets(0), m_M_num_buckets(0) {}
+    range_bucketer() : m_num_buckets(0) {}
 
     void init(const uint64_t num_buckets) {
         m_num_buckets = num_buckets;
     }
 
-    inline uint64_t bucket(const uint64_t hash) const {
+    [[gnu::hot]] [[gnu::always_inline]] inline uint64_t bucket(const uint64_t hash) const {
         return ((hash >> 32U) * m_num_buckets) >> 32U;
     }
 
+    void bucket_many(uint64_t const* hashes, const uint64_t n, uint64_t* out) const {
+        for (uint64_t i = 0; i != n; ++i) out[i] = bucket(hashes[i]);
+    }
+
     uint64_t num_buckets() const {
         return m_num_buckets;
     }
 
     size_t num_bits() const {
-        return 8 * (sizeof(m_num_buckets) + sizeof(m_M_num_buckets));
+        return 8 * sizeof(m_num_buckets);
     }
 
     void swap(range_bucketer& other) {
         std::swap(m_num_buckets, other.m_num_buckets);
-        std::swap(m_M_num_buckets, other.m_M_num_buckets);
     }
 
     template <typename Visitor>
@@ -290,11 +313,64 @@ private:
     template <typename Visitor, typename T>
     static void visit_impl(Visitor& visitor, T&& t) {
         visitor.visit(t.m_num_buckets);
-        visitor.visit(t.m_M_num_buckets);
     }
 
     uint64_t m_num_buckets;
-    __uint128_t m_M_num_buckets;
+};
+
+/*
+    Like uniform_bucketer but maps with the multiply-shift trick already used
+    by range_bucketer -- mulhi(hash, num_buckets) -- instead of a modular
+    reduction: one multiply against fastmod's mulhi + mul + sub chain. The
+    mapping differs from uniform_bucketer's residues, so this is an opt-in
+    choice for new functions, not a drop-in: a PHF must be built and queried
+    with the same bucketer.
+*/
+struct uniform_bucketer_fast {
+    uniform_bucketer_fast() : m_num_buckets(0) {}
+
+    void init(const uint64_t num_buckets, const double /* lambda */,
+              const uint64_t /* table_size */, const double /* alpha */) {
+        m_num_buckets = num_buckets;
+    }
+
+    [[gnu::hot]] [[gnu::always_inline]] inline uint64_t bucket(const uint64_t hash) const {
+        return static_cast<uint64_t>((__uint128_t(hash) * m_num_buckets) >> 64);
+    }
+
+    void bucket_many(uint64_t const* hashes, const uint64_t n, uint64_t* out) const {
+        for (uint64_t i = 0; i != n; ++i) out[i] = bucket(hashes[i]);
+    }
+
+    uint64_t num_buckets() const {
+        return m_num_buckets;
+    }
+
+    size_t num_bits() const {
+        return 8 * sizeof(m_num_buckets);
+    }
+
+    void swap(uniform_bucketer_fast& other) {
+        std::swap(m_num_buckets, other.m_num_buckets);
+    }
+
+    template <typename Visitor>
+    void visit(Visitor& visitor) const {
+        visit_impl(visitor, *this);
+    }
+
+    template <typename Visitor>
+    void visit(Visitor& visitor) {
+        visit_impl(visitor, *this);
+    }
+
+private:
+    template <typename Visitor, typename T>
+    static void visit_impl(Visitor& visitor, T&& t) {
+        visitor.visit(t.m_num_buckets);
+    }
+
+    uint64_t m_num_buckets;
 };
 
 struct uniform_bucketer {
@@ -306,10 +382,14 @@ struct uniform_bucketer {
         m_M_num_buckets = fastmod::computeM_u64(m_num_buckets);
     }
 
-    inline uint64_t bucket(const uint64_t hash) const {
+    [[gnu::hot]] [[gnu::always_inline]] inline uint64_t bucket(const uint64_t hash) const {
         return fastmod::fastmod_u64(hash, m_M_num_buckets, m_num_buckets);
     }
 
+    void bucket_many(uint64_t const* hashes, const uint64_t n, uint64_t* out) const {
+        for (uint64_t i = 0; i != n; ++i) out[i] = bucket(hashes[i]);
+    }
+
     uint64_t num_buckets() const {
         return m_num_buckets;
     }
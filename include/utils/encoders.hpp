@@ -18,6 +18,25 @@ namespace pthash {
 typedef bits::darray<bits::util::identity_getter, 4096, 64> darray1;  // take positions of 1s
 typedef bits::darray<bits::util::negating_getter, 4096, 64> darray0;  // take positions of 0s
 
+/*
+    Issue a prefetch for the storage encoder E will touch on access(i),
+    for encoders exposing a prefetch(i) hook; encoders without one cost
+    nothing. Used by the batched lookup path.
+*/
+namespace detail {
+template <typename E>
+inline auto prefetch_access(E const& e, uint64_t i, int) -> decltype(e.prefetch(i), void()) {
+    e.prefetch(i);
+}
+template <typename E>
+inline void prefetch_access(E const&, uint64_t, long) {}
+}  // namespace detail
+
+template <typename E>
+inline void prefetch_access(E const& e, uint64_t i) {
+    detail::prefetch_access(e, i, 0);
+}
+
 struct compact {
     template <typename Iterator>
     void encode(Iterator begin, const uint64_t n) {
@@ -37,10 +56,14 @@ struct compact {
         return m_values.num_bytes() * 8;
     }
 
-    uint64_t access(uint64_t i) const {
+    [[gnu::always_inline]] inline uint64_t access(uint64_t i) const {
         return m_values.access(i);
     }
 
+    inline void prefetch(uint64_t i) const {
+        __builtin_prefetch(m_values.data().data() + ((i * m_values.width()) >> 6));
+    }
+
     template <typename Visitor>
     void visit(Visitor& visitor) const {
         visitor.visit(m_values);
@@ -104,7 +127,7 @@ struct partitioned_compact {
                8;
     }
 
-    uint64_t access(uint64_t i) const {
+    [[gnu::always_inline]] inline uint64_t access(uint64_t i) const {
         uint64_t partition = i / partition_size;
         uint64_t offset = i % partition_size;
         uint64_t num_bits = m_bits_per_value[partition + 1] - m_bits_per_value[partition];
@@ -112,6 +135,10 @@ struct partitioned_compact {
         return m_values.get_bits(position, num_bits);
     }
 
+    inline void prefetch(uint64_t i) const {
+        __builtin_prefetch(m_bits_per_value.data() + i / partition_size);
+    }
+
     template <typename Visitor>
     void visit(Visitor& visitor) const {
         visit_impl(visitor, *this);
@@ -190,7 +217,7 @@ struct dictionary {
         return (m_ranks.num_bytes() + m_dict.num_bytes()) * 8;
     }
 
-    uint64_t access(uint64_t i) const {
+    [[gnu::always_inline]] inline uint64_t access(uint64_t i) const {
         PTHASH_LOG("[P6.DICT] ENTER dictionary::access(i=%llu)\n", (unsigned long long)i);
         PTHASH_LOG("[P6.DICT]   Calling m_ranks.access(%llu)...\n", (unsigned long long)i);
         uint64_t rank = m_ranks.access(i);
@@ -202,6 +229,10 @@ struct dictionary {
         return pilot;
     }
 
+    inline void prefetch(uint64_t i) const {
+        __builtin_prefetch(m_ranks.data().data() + ((i * m_ranks.width()) >> 6));
+    }
+
     template <typename Visitor>
     void visit(Visitor& visitor) const {
         visit_impl(visitor, *this);
@@ -254,11 +285,16 @@ struct elias_fano {
         return m_values.num_bytes() * 8;
     }
 
-    uint64_t access(uint64_t i) const {
+    [[gnu::always_inline]] inline uint64_t access(uint64_t i) const {
         assert(i + 1 < m_values.size());
         return m_values.diff(i);
     }
 
+    inline void prefetch(uint64_t i) const {
+        auto const& low = m_values.get_low_bits();
+        __builtin_prefetch(low.data().data() + ((i * low.width()) >> 6));
+    }
+
     template <typename Visitor>
     void visit(Visitor& visitor) const {
         visitor.visit(m_values);
@@ -302,7 +338,7 @@ struct sdc_sequence {
         m_index.encode(lengths.begin(), lengths.size());
     }
 
-    inline uint64_t access(uint64_t i) const {
+    [[gnu::always_inline]] inline uint64_t access(uint64_t i) const {
         assert(i < size());
         uint64_t pos = m_index.access(i);
         uint64_t len = m_index.access(i + 1) - pos;
@@ -312,6 +348,11 @@ struct sdc_sequence {
         return value;
     }
 
+    inline void prefetch(uint64_t i) const {
+        auto const& low = m_index.get_low_bits();
+        __builtin_prefetch(low.data().data() + ((i * low.width()) >> 6));
+    }
+
     uint64_t size() const {
         return m_size;
     }
@@ -364,11 +405,15 @@ struct sdc {
         return (m_ranks.num_bytes() + m_dict.num_bytes()) * 8;
     }
 
-    uint64_t access(uint64_t i) const {
+    [[gnu::always_inline]] inline uint64_t access(uint64_t i) const {
         uint64_t rank = m_ranks.access(i);
         return m_dict.access(rank);
     }
 
+    inline void prefetch(uint64_t i) const {
+        m_ranks.prefetch(i);
+    }
+
     template <typename Visitor>
     void visit(Visitor& visitor) const {
         visit_impl(visitor, *this);
@@ -408,7 +453,7 @@ struct dual {
         return m_front.num_bits() + m_back.num_bits();
     }
 
-    uint64_t access(uint64_t i) const {
+    [[gnu::always_inline]] inline uint64_t access(uint64_t i) const {
         PTHASH_LOG("[P6.DUAL] ENTER dual::access(i=%llu)\n", (unsigned long long)i);
         PTHASH_LOG("[P6.DUAL]   Accessing m_front.size()...\n");
         uint64_t front_size = m_front.size();
@@ -428,6 +473,15 @@ struct dual {
         return result;
     }
 
+    inline void prefetch(uint64_t i) const {
+        uint64_t front_size = m_front.size();
+        if (i < front_size) {
+            prefetch_access(m_front, i);
+        } else {
+            prefetch_access(m_back, i - front_size);
+        }
+    }
+
     template <typename Visitor>
     void visit(Visitor& visitor) const {
         visit_impl(visitor, *this);
@@ -483,7 +537,7 @@ struct rice_sequence {
         m_high_bits_d1.build(m_high_bits);
     }
 
-    inline uint64_t access(uint64_t i) const {
+    [[gnu::always_inline]] inline uint64_t access(uint64_t i) const {
         assert(i < size());
         int64_t start = -1;
         if (i) start = m_high_bits_d1.select(m_high_bits, i - 1);
@@ -492,6 +546,10 @@ struct rice_sequence {
         return (high << m_low_bits.width()) | m_low_bits.access(i);
     }
 
+    inline void prefetch(uint64_t i) const {
+        __builtin_prefetch(m_low_bits.data().data() + ((i * m_low_bits.width()) >> 6));
+    }
+
     inline uint64_t size() const {
         return m_low_bits.size();
     }
@@ -552,10 +610,14 @@ struct rice {
         return m_values.num_bits();
     }
 
-    uint64_t access(uint64_t i) const {
+    [[gnu::always_inline]] inline uint64_t access(uint64_t i) const {
         return m_values.access(i);
     }
 
+    inline void prefetch(uint64_t i) const {
+        m_values.prefetch(i);
+    }
+
     template <typename Visitor>
     void visit(Visitor& visitor) const {
         visitor.visit(m_values);
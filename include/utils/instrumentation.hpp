@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdio>
+#include <type_traits>
 
 // Define PTHASH_ENABLE_INSTRUMENTATION to 0 by default (disabled)
 #ifndef PTHASH_ENABLE_INSTRUMENTATION
@@ -14,8 +15,30 @@
     // These variables will only be defined when instrumentation is enabled
     #define PTHASH_LOG_VAR(type, name, value) type name = value
 #else
+    // The disabled forms must discard their arguments at preprocessing
+    // time (not wrap them in if(false)), so that expressions passed as
+    // log arguments -- typeid(T).name(), tellp(), string building --
+    // are never evaluated, or even parsed, in release builds.
     #define PTHASH_LOG(fmt, ...) ((void)0) // No-op
     #define PTHASH_LOG_VARS(x) ((void)0) // No-op for variables
     // In disabled mode, these will be eliminated by the compiler
     #define PTHASH_LOG_VAR(type, name, value) ((void)0)
-#endif 
\ No newline at end of file
+
+    // compile-time check that the no-op forms expand to a plain void
+    // expression with no residue
+    static_assert(std::is_void<decltype(PTHASH_LOG("x"))>::value,
+                  "PTHASH_LOG must be a no-op when instrumentation is disabled");
+    static_assert(std::is_void<decltype(PTHASH_LOG_VARS(0))>::value,
+                  "PTHASH_LOG_VARS must be a no-op when instrumentation is disabled");
+#endif
+
+/*
+    Lookups read only the object and their arguments, so release builds may
+    advertise them as pure and let the compiler CSE repeated lookups of the
+    same key. Instrumented builds must not: the logging writes to stderr.
+*/
+#if PTHASH_ENABLE_INSTRUMENTATION
+    #define PTHASH_PURE
+#else
+    #define PTHASH_PURE [[gnu::pure]]
+#endif
\ No newline at end of file
@@ -8,6 +8,10 @@
 
 #define PTHASH_LIKELY(expr) __builtin_expect((bool)(expr), true)
 
+/* out-of-line rarely-taken paths: keeps them off the hot I-cache lines and
+   lets -freorder-functions (or PGO/BOLT) move them to a cold section */
+#define PTHASH_COLD [[gnu::cold]] [[gnu::noinline]]
+
 namespace pthash {
 
 typedef std::chrono::high_resolution_clock clock_type;
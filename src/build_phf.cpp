@@ -5,16 +5,19 @@
 #include <stdexcept>
 #include <cstdint>
 #include <chrono>
-#include <iomanip> // For std::setw
-#include <numeric> // For std::iota
+#include <charconv> // For from_chars
 #include <cstdio>  // For fprintf
-#include <unordered_map> // For sample key lookup
+#include <cstring> // For memcpy
+#include <map>
 #include <thread>
+#include <fcntl.h>  // For open
+#include <unistd.h> // For pwrite, lseek, close
+
+#include "mm_file/mm_file.hpp" // For mmap-based bulk input loading
 
 // Include necessary PTHash headers
 #include "pthash.hpp"       // Main PTHash header
 #include "essentials.hpp"   // For saving/loading
-#include "nlohmann/json.hpp" // nlohmann/json library
 #include "utils/util.hpp" // For constants
 #include "utils/hasher.hpp" // For default_hash64 used in logging
 #include "utils/instrumentation.hpp"
@@ -31,134 +34,203 @@ constexpr pthash::pthash_search_type search_type = pthash::pthash_search_type::x
 using pthash_builder_type = pthash::internal_memory_builder_single_phf<hasher, pthash::skew_bucketer>;
 using pthash_function_type = pthash::single_phf<hasher, pthash::skew_bucketer, pthash::dictionary_dictionary, minimal_build, search_type>;
 
-// Helper function to read binary uint64_t keys from file
-std::vector<uint64_t> read_keys(const std::string& filename) {
-    std::ifstream input(filename, std::ios::binary);
-    if (!input) {
-        throw std::runtime_error("Cannot open key file: " + filename);
+// Allocator that default-initializes (i.e. leaves uninitialized) trivially
+// constructible elements on vector resize. The large working vectors below
+// are fully overwritten right after construction, so the value-init memset
+// std::vector would otherwise perform is pure wasted bandwidth at scale.
+template <typename T, typename A = std::allocator<T>>
+struct default_init_allocator : public A {
+    using traits = std::allocator_traits<A>;
+    template <typename U>
+    struct rebind {
+        using other = default_init_allocator<U, typename traits::template rebind_alloc<U>>;
+    };
+    using A::A;
+    template <typename U>
+    void construct(U* ptr) noexcept(std::is_nothrow_default_constructible<U>::value) {
+        ::new (static_cast<void*>(ptr)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U* ptr, Args&&... args) {
+        traits::construct(static_cast<A&>(*this), ptr, std::forward<Args>(args)...);
+    }
+};
+
+template <typename T>
+using uninit_vector = std::vector<T, default_init_allocator<T>>;
+
+// Load a count-prefixed binary array (uint64_t count, then count elements)
+// through a memory map instead of istream::read: no filebuf copy, and the
+// kernel prefetches pages ahead under the sequential advice.
+template <typename T>
+uninit_vector<T> mmap_load_prefixed(const std::string& filename) {
+    mm::file_source<uint8_t> input(filename, mm::advice::sequential);
+    if (input.bytes() < sizeof(uint64_t)) {
+        throw std::runtime_error("Failed to read element count from " + filename);
     }
-    
     uint64_t count;
-    input.read(reinterpret_cast<char*>(&count), sizeof(count));
-    if (!input) {
-        throw std::runtime_error("Failed to read key count from " + filename);
+    std::memcpy(&count, input.data(), sizeof(count));
+    if (input.bytes() < sizeof(uint64_t) + count * sizeof(T)) {
+        throw std::runtime_error("Failed to read all elements from " + filename +
+                                 ": file truncated");
     }
-    
-    std::vector<uint64_t> keys(count);
-    input.read(reinterpret_cast<char*>(keys.data()), count * sizeof(uint64_t));
-    if (!input) {
-        throw std::runtime_error("Failed to read all keys from " + filename);
+    uninit_vector<T> out(count);
+    std::memcpy(out.data(), input.data() + sizeof(uint64_t), count * sizeof(T));
+    return out;
+}
+
+// pwrite the whole buffer at the given offset, retrying on short writes.
+static bool write_all_at(int fd, void const* data, size_t bytes, off_t offset) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes != 0) {
+        ssize_t written = ::pwrite(fd, p, bytes, offset);
+        if (written <= 0) return false;
+        p += written;
+        offset += written;
+        bytes -= written;
     }
-    
-    return keys;
+    return true;
+}
+
+// Helper function to read binary uint64_t keys from file
+uninit_vector<uint64_t> read_keys(const std::string& filename) {
+    return mmap_load_prefixed<uint64_t>(filename);
 }
 
 // Helper function to read binary uint16_t values from file
-std::vector<uint16_t> read_values(const std::string& filename) {
-    std::ifstream input(filename, std::ios::binary);
-    if (!input) {
-        throw std::runtime_error("Cannot open value file: " + filename);
+uninit_vector<uint16_t> read_values(const std::string& filename) {
+    return mmap_load_prefixed<uint16_t>(filename);
+}
+
+// --- Helper Functions for JSON Generation ---
+
+// Streaming pretty-printer (2-space indent) writing straight to a FILE*.
+// The ground-truth dump used to assemble a nlohmann::json DOM and then
+// dump(2) it; for the DArray inventories that meant one heap-allocated
+// node per uint64 entry plus a full re-serialization pass. Streaming
+// emits each element as it is visited with no intermediate tree. Keys
+// are emitted in alphabetical order within each object, matching the
+// std::map ordering the DOM produced.
+struct json_writer {
+    explicit json_writer(FILE* f) : m_out(f) {}
+
+    void begin_object() { open('{'); }
+    void end_object() { close('}'); }
+    void begin_array() { open('['); }
+    void end_array() { close(']'); }
+
+    void key(std::string const& k) {
+        element_prefix();
+        fprintf(m_out, "\"%s\": ", k.c_str());
+        m_pending_value = true;
     }
-    
-    uint64_t count;
-    input.read(reinterpret_cast<char*>(&count), sizeof(count));
-    if (!input) {
-        throw std::runtime_error("Failed to read value count from " + filename);
+    void u64(uint64_t v) {
+        element_prefix();
+        fprintf(m_out, "%llu", (unsigned long long)v);
     }
-    
-    std::vector<uint16_t> values(count);
-    input.read(reinterpret_cast<char*>(values.data()), count * sizeof(uint16_t));
-    if (!input) {
-        throw std::runtime_error("Failed to read all values from " + filename);
+    void f64(double v) {
+        element_prefix();
+        // %.17g round-trips any double exactly
+        fprintf(m_out, "%.17g", v);
+    }
+    template <typename Vec>
+    void u64_array(Vec const& vec) {
+        begin_array();
+        for (auto x : vec) u64(uint64_t(x));
+        end_array();
     }
-    
-    return values;
-}
 
-// --- NEW Helper Functions for JSON Generation ---
+private:
+    // comma/newline/indent before each element; suppressed right after a
+    // key, whose value continues the same line
+    void element_prefix() {
+        if (m_pending_value) {
+            m_pending_value = false;
+            return;
+        }
+        if (!m_scope_has_elements.empty()) {
+            if (m_scope_has_elements.back()) fputc(',', m_out);
+            m_scope_has_elements.back() = 1;
+            newline_indent(m_scope_has_elements.size());
+        }
+    }
+    void open(char c) {
+        element_prefix();
+        fputc(c, m_out);
+        m_scope_has_elements.push_back(0);
+    }
+    void close(char c) {
+        bool had_elements = m_scope_has_elements.back();
+        m_scope_has_elements.pop_back();
+        if (had_elements) newline_indent(m_scope_has_elements.size());
+        fputc(c, m_out);
+    }
+    void newline_indent(size_t depth) {
+        fputc('\n', m_out);
+        for (size_t i = 0; i != depth; ++i) fputs("  ", m_out);
+    }
 
-nlohmann::json get_bit_vector_details(const bits::bit_vector& bv) {
-    nlohmann::json j;
-    // *** DEBUG PRINT ***
-    PTHASH_LOG("[DEBUG] get_bit_vector_details: bv.num_bits()=%llu, bv.data().size()=%lu\n",
-            (unsigned long long)bv.num_bits(), (unsigned long)bv.data().size());
-    // --- END DEBUG PRINT ---
-    j["NumBits"] = bv.num_bits();
-    j["DataVecLen"] = bv.data().size(); // Use existing data() method
-    return j;
-}
+    FILE* m_out;
+    std::vector<uint8_t> m_scope_has_elements;
+    bool m_pending_value = false;
+};
 
-// Add a helper function for std::vector<uint64_t>
-nlohmann::json get_vector_uint64_details(const std::vector<uint64_t>& vec) {
-    nlohmann::json j;
+void write_bit_vector_details(json_writer& w, const bits::bit_vector& bv) {
     // *** DEBUG PRINT ***
-    PTHASH_LOG("[DEBUG] get_vector_uint64_details: vec.size()=%lu\n", (unsigned long)vec.size());
+    PTHASH_LOG("[DEBUG] write_bit_vector_details: bv.num_bits()=%llu, bv.data().size()=%lu\n",
+            (unsigned long long)bv.num_bits(), (unsigned long)bv.data().size());
     // --- END DEBUG PRINT ---
-    j["Size"] = vec.size();
-    return j;
+    w.begin_object();
+    w.key("DataVecLen"); w.u64(bv.data().size()); // Use existing data() method
+    w.key("NumBits"); w.u64(bv.num_bits());
+    w.end_object();
 }
 
-nlohmann::json get_compact_vector_details(const bits::compact_vector& cv) {
-    nlohmann::json j;
+void write_compact_vector_details(json_writer& w, const bits::compact_vector& cv) {
     // *** DEBUG PRINT ***
-    PTHASH_LOG("[DEBUG] get_compact_vector_details: cv.size()=%llu, cv.width()=%llu, cv.data().size()=%lu\n",
+    PTHASH_LOG("[DEBUG] write_compact_vector_details: cv.size()=%llu, cv.width()=%llu, cv.data().size()=%lu\n",
            (unsigned long long)cv.size(), (unsigned long long)cv.width(), (unsigned long)cv.data().size());
     // --- END DEBUG PRINT ---
-    j["Size"] = cv.size(); // Use existing size() method
-    j["Width"] = cv.width(); // Use existing width() method
+    w.begin_object();
+    w.key("Data");
+    w.begin_object();
+    w.key("Size"); w.u64(cv.data().size());
+    w.end_object();
     // Calculate mask based on width
     uint64_t width = cv.width();
-    j["Mask"] = (width == 64) ? uint64_t(-1) : ((uint64_t(1) << width) - 1);
-    j["Data"] = get_vector_uint64_details(cv.data()); // Use specific vector helper
-    return j;
-}
-
-nlohmann::json get_dictionary_details(const pthash::dictionary& d) {
-     nlohmann::json j;
-     // Use public getters we defined
-     j["Ranks"] = get_compact_vector_details(d.get_ranks());
-     j["Dict"] = get_compact_vector_details(d.get_dict());
-     return j;
+    w.key("Mask"); w.u64((width == 64) ? uint64_t(-1) : ((uint64_t(1) << width) - 1));
+    w.key("Size"); w.u64(cv.size());   // Use existing size() method
+    w.key("Width"); w.u64(cv.width()); // Use existing width() method
+    w.end_object();
 }
 
-nlohmann::json get_dictionary_dictionary_details(const pthash::dictionary_dictionary& dd) {
-     nlohmann::json j;
-     // dd is dual<dictionary, dictionary>
-     j["Front"] = get_dictionary_details(dd.get_front()); // Use temporary getter
-     j["Back"] = get_dictionary_details(dd.get_back());   // Use temporary getter
-     return j;
+void write_dictionary_details(json_writer& w, const pthash::dictionary& d) {
+    // Use public getters we defined
+    w.begin_object();
+    w.key("Dict"); write_compact_vector_details(w, d.get_dict());
+    w.key("Ranks"); write_compact_vector_details(w, d.get_ranks());
+    w.end_object();
 }
 
-nlohmann::json get_elias_fano_details(const bits::elias_fano<false, false>& ef) {
-     nlohmann::json j;
-     // In the C++ structure, ef.get_back() contains the universe size (m_back)
-     // And ef.size() returns the number of keys (m_low_bits.size())
-     j["UniverseSize"] = ef.get_back(); // Include universe size for debugging
-     j["NumKeys"] = ef.size(); // Use existing size() method
-
-     // Debug print for troubleshooting serialization vs loading
-     PTHASH_LOG("[DEBUG] EliasFano details: UniverseSize=%llu, NumKeys=%llu\n",
-             (unsigned long long)ef.get_back(), (unsigned long long)ef.size());
-     // --- END DEBUG PRINT ---
-
-     // Use public getters we defined
-     j["HighBits"] = get_bit_vector_details(ef.get_high_bits());
-     j["LowBits"] = get_compact_vector_details(ef.get_low_bits());
-     return j;
+void write_dictionary_dictionary_details(json_writer& w, const pthash::dictionary_dictionary& dd) {
+    // dd is dual<dictionary, dictionary>
+    w.begin_object();
+    w.key("Back"); write_dictionary_details(w, dd.get_back());
+    w.key("Front"); write_dictionary_details(w, dd.get_front());
+    w.end_object();
 }
 
-
-nlohmann::json get_skew_bucketer_details(const pthash::skew_bucketer& b) {
-    nlohmann::json j;
-    j["NumDense"] = b.get_num_dense_buckets(); // Use temporary getter
-    j["NumSparse"] = b.get_num_sparse_buckets(); // Use temporary getter
-    __uint128_t m_dense = b.get_M_dense();       // Use temporary getter
-    __uint128_t m_sparse = b.get_M_sparse();     // Use temporary getter
-    j["MDenseH"] = uint64_t(m_dense >> 64);
-    j["MDenseL"] = uint64_t(m_dense);
-    j["MSparseH"] = uint64_t(m_sparse >> 64);
-    j["MSparseL"] = uint64_t(m_sparse);
-    return j;
+void write_skew_bucketer_details(json_writer& w, const pthash::skew_bucketer& b) {
+    __uint128_t m_dense = b.get_M_dense();   // Use temporary getter
+    __uint128_t m_sparse = b.get_M_sparse(); // Use temporary getter
+    w.begin_object();
+    w.key("MDenseH"); w.u64(uint64_t(m_dense >> 64));
+    w.key("MDenseL"); w.u64(uint64_t(m_dense));
+    w.key("MSparseH"); w.u64(uint64_t(m_sparse >> 64));
+    w.key("MSparseL"); w.u64(uint64_t(m_sparse));
+    w.key("NumDense"); w.u64(b.get_num_dense_buckets());
+    w.key("NumSparse"); w.u64(b.get_num_sparse_buckets());
+    w.end_object();
 }
 
 
@@ -170,12 +242,23 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    // from_chars: locale-free, non-throwing, no iostream machinery
+    auto parse_arg = [](const char* arg, auto& out, const char* what) {
+        auto [ptr, ec] = std::from_chars(arg, arg + std::strlen(arg), out);
+        if (ec != std::errc() || *ptr != '\0') {
+            std::cerr << "Cannot parse " << what << ": '" << arg << "'" << std::endl;
+            std::exit(1);
+        }
+    };
+
     std::string keys_filename = argv[1];
     std::string values_filename = argv[2];
     std::string output_filename = argv[3];
-    double alpha = std::stod(argv[4]);
-    double lambda = std::stod(argv[5]);
-    uint64_t fixed_seed = (argc == 7) ? std::stoull(argv[6]) : pthash::constants::invalid_seed; // Use provided seed or mark as invalid if random needed
+    double alpha, lambda;
+    parse_arg(argv[4], alpha, "alpha");
+    parse_arg(argv[5], lambda, "lambda");
+    uint64_t fixed_seed = pthash::constants::invalid_seed; // Use provided seed or mark as invalid if random needed
+    if (argc == 7) parse_arg(argv[6], fixed_seed, "seed");
 
     bool generate_details = (argc == 7); // Generate details only if seed is provided
 
@@ -223,79 +306,151 @@ int main(int argc, char** argv) {
         pthash_function_type mphf;
         uint64_t encode_time = mphf.build(builder, config);
         timings.encoding_microseconds = encode_time;
-        std::cerr << "PHF built." << std::endl;
-
-        // Reorder values (same as before)
+        std::cerr << "PHF built (mapping+ordering: " << timings.mapping_ordering_microseconds
+                  << " us, searching: " << timings.searching_microseconds
+                  << " us, encoding: " << timings.encoding_microseconds << " us)." << std::endl;
+
+        // Reorder values. Directly scattering values[i] to slot mphf(keys[i])
+        // touches a random cache line of the N-element output per key; once
+        // 2N bytes exceed L3 every store is a cold-line RFO. Radix-partition
+        // instead: stage (slot, value) pairs grouped by the high bits of the
+        // slot, then drain one partition at a time so the writes of each
+        // partition stay within an N/64 slice of the output. Same total
+        // work, far less DRAM write traffic.
         std::cerr << "Reordering values..." << std::endl;
-        std::vector<uint16_t> reordered_values(num_keys);
+        uninit_vector<uint16_t> reordered_values(num_keys);
         // Precompute indices to avoid repeated lookups during sample extraction if needed later
-        std::vector<uint64_t> final_indices(num_keys);
-        for (uint64_t i = 0; i < num_keys; ++i) {
-            uint64_t phf_index = mphf(keys[i]);
-            if (phf_index >= num_keys) {
-                 PTHASH_LOG("CRITICAL ERROR: PHF index %llu out of bounds for key %llu (num_keys=%llu)!\n",
-                         (unsigned long long)phf_index, (unsigned long long)keys[i], (unsigned long long)num_keys);
-                 throw std::runtime_error("PHF index out of bounds!");
+        uninit_vector<uint64_t> final_indices(num_keys);
+        if (num_keys != 0) {
+            uint64_t num_threads = config.num_threads;
+            if (num_threads == 0) num_threads = 1;
+            if (num_threads > num_keys) num_threads = num_keys;
+
+            // 1) compute all slots; batched lookups overlap the pilot cache
+            // misses of consecutive keys within each thread (threads over
+            // contiguous key ranges, like the builder's map_parallel)
+            {
+                auto exe = [&](uint64_t begin, uint64_t end) {
+                    mphf.lookup_batch(keys.begin() + begin, end - begin,
+                                      final_indices.data() + begin);
+                };
+                uint64_t keys_per_thread = num_keys / num_threads;
+                std::vector<std::thread> threads;
+                threads.reserve(num_threads);
+                for (uint64_t t = 0; t != num_threads; ++t) {
+                    uint64_t begin = t * keys_per_thread;
+                    uint64_t end = (t != num_threads - 1) ? begin + keys_per_thread : num_keys;
+                    threads.emplace_back(exe, begin, end);
+                }
+                for (auto& t : threads) t.join();
+            }
+
+            // 2) bounds-check and histogram the slots by their high bits
+            constexpr uint64_t num_partitions = 64;
+            uint32_t shift = 0;
+            while ((num_keys - 1) >> shift >= num_partitions) ++shift;
+            std::vector<uint64_t> offsets(num_partitions + 1, 0);
+            for (uint64_t i = 0; i != num_keys; ++i) {
+                uint64_t phf_index = final_indices[i];
+                if (phf_index >= num_keys) {
+                    PTHASH_LOG("CRITICAL ERROR: PHF index %llu out of bounds for key %llu (num_keys=%llu)!\n",
+                            (unsigned long long)phf_index, (unsigned long long)keys[i], (unsigned long long)num_keys);
+                    throw std::runtime_error("PHF index out of bounds!");
+                }
+                ++offsets[(phf_index >> shift) + 1];
+            }
+            for (uint64_t b = 1; b != num_partitions + 1; ++b) offsets[b] += offsets[b - 1];
+
+            // 3) stage (slot, value) partition-ordered: sequential reads, 64
+            // streaming write heads. Staging the value alongside the slot
+            // keeps the drain pass free of random gathers from values[].
+            uninit_vector<uint64_t> staged_slot(num_keys);
+            uninit_vector<uint16_t> staged_value(num_keys);
+            std::vector<uint64_t> cursor(offsets.begin(), offsets.end() - 1);
+            for (uint64_t i = 0; i != num_keys; ++i) {
+                uint64_t slot = final_indices[i];
+                uint64_t k = cursor[slot >> shift]++;
+                staged_slot[k] = slot;
+                staged_value[k] = values[i];
+            }
+
+            // Past this point only the ground-truth dump reads final_indices;
+            // in the common path release its 8N bytes before the drain
+            if (!generate_details) uninit_vector<uint64_t>().swap(final_indices);
+
+            // 4) drain partitions; each writes a disjoint contiguous slice of
+            // reordered_values, so threads need no synchronization
+            {
+                auto drain = [&](uint64_t part_begin, uint64_t part_end) {
+                    for (uint64_t k = offsets[part_begin]; k != offsets[part_end]; ++k) {
+                        reordered_values[staged_slot[k]] = staged_value[k];
+                    }
+                };
+                uint64_t drain_threads = std::min<uint64_t>(num_threads, num_partitions);
+                uint64_t parts_per_thread = num_partitions / drain_threads;
+                std::vector<std::thread> threads;
+                threads.reserve(drain_threads);
+                for (uint64_t t = 0; t != drain_threads; ++t) {
+                    uint64_t begin = t * parts_per_thread;
+                    uint64_t end = (t != drain_threads - 1) ? begin + parts_per_thread
+                                                            : num_partitions;
+                    threads.emplace_back(drain, begin, end);
+                }
+                for (auto& t : threads) t.join();
             }
-            reordered_values[phf_index] = values[i];
-            final_indices[i] = phf_index; // Store final index
         }
         std::cerr << "Values reordered." << std::endl;
 
         // --- Generate COMPLETE Ground Truth JSON ---
         if (generate_details) {
             std::cerr << "Generating COMPLETE ground truth details..." << std::endl;
-            nlohmann::json gt;
-
-            // Basic Info
-            gt["seed"] = mphf.get_seed();
-            gt["num_keys"] = mphf.get_num_keys();
-            gt["build_params"]["alpha"] = alpha;
-            gt["build_params"]["lambda"] = lambda;
-
-            // Header Params (using getters)
-            gt["header_params"]["table_size"] = mphf.get_table_size();
-            __uint128_t M128 = mphf.get_M_128(); // Correct capitalization in getter name
-            uint64_t M64 = mphf.get_M_64();      // Correct capitalization in getter name
-            gt["header_params"]["M128High"] = uint64_t(M128 >> 64);
-            gt["header_params"]["M128Low"] = uint64_t(M128);
-            gt["header_params"]["M64"] = M64;
-
-            // Bucketer Params (using getter + helper)
-            gt["bucketer_params"] = get_skew_bucketer_details(mphf.get_bucketer());
-
-            // Pilot Structure (using getter + helper)
-            gt["pilot_structure"] = get_dictionary_dictionary_details(mphf.get_pilots());
-
-            // Free Slots Structure (using getter + helper)
-            gt["free_slots_structure"] = get_elias_fano_details(mphf.get_free_slots());
 
             // --- Sample Key Details ---
-            nlohmann::json sample_hashes = nlohmann::json::object();
-            nlohmann::json sample_buckets = nlohmann::json::object();
-            nlohmann::json sample_pilots = nlohmann::json::object(); // Stores pilot per *bucket*
-            nlohmann::json sample_positions = nlohmann::json::object();
-            nlohmann::json sample_final_indices = nlohmann::json::object(); // Store final index
-            nlohmann::json sample_reordered_values = nlohmann::json::object(); // Store value at final index
-            nlohmann::json sample_original_values = nlohmann::json::array(); // Also capture original values for samples
-            nlohmann::json sample_lookup_phase5 = nlohmann::json::object(); // NEW for phase 5 intermediates
-
-            // Find original indices of sample keys
+            // Small ordered maps (one entry per sample key): sorted string
+            // keys match the ordering the old DOM-based dump produced.
+            std::map<std::string, std::pair<uint64_t, uint64_t>> sample_hashes;
+            std::map<std::string, uint64_t> sample_buckets;
+            std::map<std::string, uint64_t> sample_pilots; // Stores pilot per *bucket*
+            std::map<std::string, uint64_t> sample_positions;
+            std::map<std::string, uint64_t> sample_final_indices; // Store final index
+            std::map<std::string, uint64_t> sample_reordered_values; // Store value at final index
+            std::vector<uint16_t> sample_original_values; // Also capture original values for samples
+            std::map<std::string, std::pair<uint64_t, uint64_t>> sample_lookup_phase5; // (bucket_id, hash1)
+
+            // Find original indices of sample keys. A single scan comparing
+            // each key against the handful of samples: no need for the
+            // num_keys-sized hash map this used to build (tens of bytes per
+            // entry, allocated and thrown away for ~10 lookups).
             std::vector<uint64_t> sample_indices;
-            std::unordered_map<uint64_t, uint64_t> key_to_original_index;
-            for(uint64_t i=0; i<keys.size(); ++i) key_to_original_index[keys[i]] = i;
-
-            for (const auto& sk : sample_keys) {
-                 auto it = key_to_original_index.find(sk);
-                 if (it != key_to_original_index.end()) {
-                     sample_indices.push_back(it->second);
+            constexpr uint64_t sample_not_found = uint64_t(-1);
+            std::vector<uint64_t> found_at(num_samples, sample_not_found);
+            for (uint64_t i = 0; i != keys.size(); ++i) {
+                for (size_t s = 0; s != num_samples; ++s) {
+                    if (keys[i] == sample_keys[s]) found_at[s] = i;
+                }
+            }
+            for (size_t s = 0; s != num_samples; ++s) {
+                 if (found_at[s] != sample_not_found) {
+                     sample_indices.push_back(found_at[s]);
                  } else {
-                     PTHASH_LOG("Warning: Sample key %llu not found in input keys!\n", (unsigned long long)sk);
+                     PTHASH_LOG("Warning: Sample key %llu not found in input keys!\n",
+                             (unsigned long long)sample_keys[s]);
                  }
             }
 
 
             std::vector<uint64_t> sample_key_list_for_json;
+             // Loop-invariant lookups, hoisted out of the sample loop
+             const uint64_t seed = mphf.get_seed();
+             const auto& bkt = mphf.get_bucketer();
+             const auto& pilots = mphf.get_pilots();
+             // DEBUG INSTRUMENTATION: Print internal M values from bucketer
+             PTHASH_LOG_VARS(__uint128_t m_dense = bkt.get_M_dense());
+             PTHASH_LOG_VARS(__uint128_t m_sparse = bkt.get_M_sparse());
+             PTHASH_LOG("[BUILD_PHF DEBUG] m_M_dense H=0x%llx L=0x%llx\n",
+                     (unsigned long long)(m_dense >> 64), (unsigned long long)m_dense);
+             PTHASH_LOG("[BUILD_PHF DEBUG] m_M_sparse H=0x%llx L=0x%llx\n",
+                     (unsigned long long)(m_sparse >> 64), (unsigned long long)m_sparse);
              // Limit to actual found samples or requested number, whichever is smaller
              size_t actual_samples = std::min(sample_indices.size(), num_samples);
              for (size_t i = 0; i < actual_samples; ++i) {
@@ -309,28 +464,20 @@ int main(int argc, char** argv) {
 
 
                 // --- Phase 5 Intermediates ---
-                auto h = hasher::hash(key, mphf.get_seed());
+                auto h = hasher::hash(key, seed);
                 uint64_t h1 = h.first(); // Used for bucketing
                 uint64_t h2 = h.second(); // Used for displacement
 
-                // DEBUG INSTRUMENTATION: Print internal M values from bucketer
-                PTHASH_LOG_VARS(__uint128_t m_dense = mphf.get_bucketer().get_M_dense());
-                PTHASH_LOG_VARS(__uint128_t m_sparse = mphf.get_bucketer().get_M_sparse());
-                
                 PTHASH_LOG("[BUILD_PHF DEBUG] Key=%llu, h1=0x%llx\n", (unsigned long long)key, (unsigned long long)h1);
-                PTHASH_LOG("[BUILD_PHF DEBUG] m_M_dense H=0x%llx L=0x%llx\n", 
-                        (unsigned long long)(m_dense >> 64), (unsigned long long)m_dense);
-                PTHASH_LOG("[BUILD_PHF DEBUG] m_M_sparse H=0x%llx L=0x%llx\n", 
-                        (unsigned long long)(m_sparse >> 64), (unsigned long long)m_sparse);
-                
+
                 // Store both hashes for clarity, even if they are the same for murmurhash2_64
                 sample_hashes[key_str] = {h1, h2};
-                uint64_t bucket_id = mphf.get_bucketer().bucket(h.first());
-                sample_lookup_phase5[key_str] = { {"hash1", h1}, {"bucket_id", bucket_id} };
+                uint64_t bucket_id = bkt.bucket(h1);
+                sample_lookup_phase5[key_str] = {bucket_id, h1};
                 // --- End Phase 5 Intermediates ---
                 sample_buckets[key_str] = bucket_id;
 
-                uint64_t pilot_val = mphf.get_pilots().access(bucket_id);
+                uint64_t pilot_val = pilots.access(bucket_id);
                 sample_pilots[std::to_string(bucket_id)] = pilot_val; // Store pilot per bucket_id
 
                 uint64_t pos_raw = mphf.position_raw(h); // Use temporary raw position getter
@@ -341,42 +488,124 @@ int main(int argc, char** argv) {
                 sample_reordered_values[key_str] = reordered_values[final_index];
             }
 
-            // Add sample data lists to JSON
-            gt["sample_data"]["keys"] = sample_key_list_for_json;
-            gt["sample_data"]["original_values"] = sample_original_values;
-
-
-            // Add intermediate and final lookup data maps to JSON
-            gt["sample_key_hashes"] = sample_hashes;
-            gt["sample_key_buckets"] = sample_buckets;
-            gt["sample_lookup_phase5"] = sample_lookup_phase5; // Add phase 5 intermediates
-            gt["sample_bucket_pilots"] = sample_pilots;
-            gt["sample_key_raw_positions"] = sample_positions; // Renamed for clarity
-            gt["sample_final_indices"] = sample_final_indices; // Added final index
-            gt["sample_reordered_values"] = sample_reordered_values; // Renamed for clarity
-
-            // --- ADD DARRAY DETAILS to free_slots_structure JSON ---
-            nlohmann::json darray1_details;
-            const auto& d1 = mphf.get_free_slots().get_high_bits_d1(); // Use getter
-            darray1_details["Positions"] = d1.getNumPositions();         // Use existing getter
-            darray1_details["BlockInventory"] = d1.getBlockInventory(); // Use existing getter
-            darray1_details["SubBlockInventory"] = d1.getSubblockInventory(); // Use existing getter
-            darray1_details["OverflowPositions"] = d1.getOverflowPositions(); // Use existing getter
-            gt["free_slots_structure"]["DArray1_Details"] = darray1_details; // Add to JSON
-
-            nlohmann::json darray0_details;
-            const auto& d0 = mphf.get_free_slots().get_high_bits_d0(); // Use getter
-            darray0_details["Positions"] = d0.getNumPositions();
-            darray0_details["BlockInventory"] = d0.getBlockInventory();
-            darray0_details["SubBlockInventory"] = d0.getSubblockInventory();
-            darray0_details["OverflowPositions"] = d0.getOverflowPositions();
-            gt["free_slots_structure"]["DArray0_Details"] = darray0_details; // Add to JSON
-
-            std::cerr << "Added DArray inventory details to ground truth JSON." << std::endl;
-            // --- END ADDING DARRAY DETAILS ---
-
-            // Output the detailed JSON to stdout for the script to capture
-            std::cout << gt.dump(2) << std::endl; // Use indent 2 for readability
+            // --- Stream the document to stdout for the script to capture ---
+            json_writer w(stdout);
+            w.begin_object();
+
+            w.key("build_params");
+            w.begin_object();
+            w.key("alpha"); w.f64(alpha);
+            w.key("lambda"); w.f64(lambda);
+            w.end_object();
+
+            // Bucketer Params (using getter + helper)
+            w.key("bucketer_params");
+            write_skew_bucketer_details(w, mphf.get_bucketer());
+
+            // Free Slots Structure, with the DArray inventories streamed
+            // element-by-element (these are the unbounded arrays the old DOM
+            // materialized in full)
+            w.key("free_slots_structure");
+            w.begin_object();
+            const auto& free_slots = mphf.get_free_slots();
+            PTHASH_LOG("[DEBUG] EliasFano details: UniverseSize=%llu, NumKeys=%llu\n",
+                    (unsigned long long)free_slots.get_back(), (unsigned long long)free_slots.size());
+            // free_slots does not index zeros (index_zeros = false), so its
+            // darray0 no longer exists as a member; keep the JSON shape with
+            // the empty details it always produced.
+            w.key("DArray0_Details");
+            w.begin_object();
+            w.key("BlockInventory"); w.begin_array(); w.end_array();
+            w.key("OverflowPositions"); w.begin_array(); w.end_array();
+            w.key("Positions"); w.u64(0);
+            w.key("SubBlockInventory"); w.begin_array(); w.end_array();
+            w.end_object();
+            w.key("DArray1_Details");
+            w.begin_object();
+            const auto& d1 = free_slots.get_high_bits_d1(); // Use getter
+            // the block inventory is bit-packed; decode it for the JSON dump
+            std::vector<uint64_t> d1_blocks(d1.getBlockInventory().size());
+            d1.getBlockInventory().decode_range(0, d1_blocks.size(), d1_blocks.data());
+            w.key("BlockInventory"); w.u64_array(d1_blocks);
+            w.key("OverflowPositions"); w.u64_array(d1.getOverflowPositions());
+            w.key("Positions"); w.u64(d1.getNumPositions());
+            w.key("SubBlockInventory"); w.u64_array(d1.getSubblockInventory());
+            w.end_object();
+            w.key("HighBits"); write_bit_vector_details(w, free_slots.get_high_bits());
+            w.key("LowBits"); write_compact_vector_details(w, free_slots.get_low_bits());
+            // In the C++ structure, free_slots.get_back() is the universe
+            // size (m_back) and size() the number of keys (m_low_bits.size())
+            w.key("NumKeys"); w.u64(free_slots.size());
+            w.key("UniverseSize"); w.u64(free_slots.get_back());
+            w.end_object();
+
+            // Header Params (using getters)
+            __uint128_t M128 = mphf.get_M_128(); // Correct capitalization in getter name
+            uint64_t M64 = mphf.get_M_64();      // Correct capitalization in getter name
+            w.key("header_params");
+            w.begin_object();
+            w.key("M128High"); w.u64(uint64_t(M128 >> 64));
+            w.key("M128Low"); w.u64(uint64_t(M128));
+            w.key("M64"); w.u64(M64);
+            w.key("table_size"); w.u64(mphf.get_table_size());
+            w.end_object();
+
+            w.key("num_keys"); w.u64(mphf.get_num_keys());
+
+            // Pilot Structure (using getter + helper)
+            w.key("pilot_structure");
+            write_dictionary_dictionary_details(w, mphf.get_pilots());
+
+            // Intermediate and final lookup data maps
+            auto write_u64_map = [&w](std::map<std::string, uint64_t> const& m) {
+                w.begin_object();
+                for (auto const& kv : m) {
+                    w.key(kv.first);
+                    w.u64(kv.second);
+                }
+                w.end_object();
+            };
+            w.key("sample_bucket_pilots"); write_u64_map(sample_pilots);
+
+            w.key("sample_data");
+            w.begin_object();
+            w.key("keys"); w.u64_array(sample_key_list_for_json);
+            w.key("original_values"); w.u64_array(sample_original_values);
+            w.end_object();
+
+            w.key("sample_final_indices"); write_u64_map(sample_final_indices);
+            w.key("sample_key_buckets"); write_u64_map(sample_buckets);
+
+            w.key("sample_key_hashes");
+            w.begin_object();
+            for (auto const& kv : sample_hashes) {
+                w.key(kv.first);
+                w.begin_array();
+                w.u64(kv.second.first);
+                w.u64(kv.second.second);
+                w.end_array();
+            }
+            w.end_object();
+
+            w.key("sample_key_raw_positions"); write_u64_map(sample_positions);
+
+            w.key("sample_lookup_phase5");
+            w.begin_object();
+            for (auto const& kv : sample_lookup_phase5) {
+                w.key(kv.first);
+                w.begin_object();
+                w.key("bucket_id"); w.u64(kv.second.first);
+                w.key("hash1"); w.u64(kv.second.second);
+                w.end_object();
+            }
+            w.end_object();
+
+            w.key("sample_reordered_values"); write_u64_map(sample_reordered_values);
+            w.key("seed"); w.u64(mphf.get_seed());
+
+            w.end_object();
+            fputc('\n', stdout);
+            fflush(stdout);
             std::cerr << "Ground truth details generated and printed to stdout." << std::endl;
 
         }
@@ -385,14 +614,26 @@ int main(int argc, char** argv) {
         // Save PHF and reordered values (same as before)
         std::cerr << "Saving PHF and values to " << output_filename << "..." << std::endl;
         essentials::save(mphf, output_filename.c_str()); // Save the PHF structure itself
-        std::ofstream os(output_filename, std::ios::binary | std::ios::app); // Append values
-        if (!os) throw std::runtime_error("Cannot open output file for appending: " + output_filename);
+        // Append the value array with pwrite: ofstream would route the bulk
+        // buffer through its userspace filebuf (an extra copy plus stream
+        // locking per write); pwrite hands the whole buffer to the kernel in
+        // one call. Note pwrite ignores the offset on an O_APPEND fd, so the
+        // file is opened plain O_WRONLY and the append offset taken from
+        // lseek(SEEK_END).
+        int fd = ::open(output_filename.c_str(), O_WRONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open output file for appending: " + output_filename);
+        off_t off = ::lseek(fd, 0, SEEK_END);
+        if (off < 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot seek to end of output file: " + output_filename);
+        }
         uint64_t value_count = reordered_values.size();
         // Write count THEN values
-        os.write(reinterpret_cast<const char*>(&value_count), sizeof(value_count));
-        os.write(reinterpret_cast<const char*>(reordered_values.data()), value_count * sizeof(uint16_t));
-        if (!os) throw std::runtime_error("Error writing values to output file");
-        os.close();
+        bool ok = write_all_at(fd, &value_count, sizeof(value_count), off) &&
+                  write_all_at(fd, reordered_values.data(), value_count * sizeof(uint16_t),
+                               off + sizeof(value_count));
+        ::close(fd);
+        if (!ok) throw std::runtime_error("Error writing values to output file");
         std::cerr << "Saved data." << std::endl;
 
     } catch (const std::exception& e) {
@@ -3,6 +3,122 @@
 #include <random>
 #include <vector>
 #include <stdint.h>
+#include <string.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/*
+    Batched xoshiro256++ generator. The previous std::mt19937_64 loop ran the
+    full Mersenne twist per key and dominated the tool's runtime for large
+    num_keys; xoshiro256++ is a handful of xor/shift/rotate ops and its output
+    is already uniform over the full 64-bit range, so the
+    uniform_int_distribution layer is dropped as well. With AVX2 four
+    independent streams advance in lockstep, one 256-bit store per iteration.
+*/
+
+// splitmix64: recommended seeder for xoshiro state.
+static uint64_t splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+#ifdef __AVX2__
+
+struct xoshiro256pp_x4 {
+    __m256i s0, s1, s2, s3;
+
+    explicit xoshiro256pp_x4(uint64_t seed) {
+        uint64_t s[4][4];
+        for (int lane = 0; lane != 4; ++lane) {
+            for (int word = 0; word != 4; ++word) s[word][lane] = splitmix64(seed);
+        }
+        s0 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(s[0]));
+        s1 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(s[1]));
+        s2 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(s[2]));
+        s3 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(s[3]));
+    }
+
+    static inline __m256i rotl(__m256i x, int k) {
+        return _mm256_or_si256(_mm256_slli_epi64(x, k), _mm256_srli_epi64(x, 64 - k));
+    }
+
+    // Four uint64 draws, one per lane.
+    inline __m256i next4() {
+        const __m256i result = _mm256_add_epi64(rotl(_mm256_add_epi64(s0, s3), 23), s0);
+        const __m256i t = _mm256_slli_epi64(s1, 17);
+        s2 = _mm256_xor_si256(s2, s0);
+        s3 = _mm256_xor_si256(s3, s1);
+        s1 = _mm256_xor_si256(s1, s2);
+        s0 = _mm256_xor_si256(s0, s3);
+        s2 = _mm256_xor_si256(s2, t);
+        s3 = rotl(s3, 45);
+        return result;
+    }
+};
+
+static void fill_random(uint64_t seed, std::vector<uint64_t>& keys,
+                        std::vector<uint16_t>& values) {
+    xoshiro256pp_x4 rng(seed);
+    const uint64_t n = keys.size();
+    const uint64_t n4 = n & ~uint64_t(3);
+    for (uint64_t i = 0; i != n4; i += 4) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&keys[i]), rng.next4());
+    }
+    for (uint64_t i = 0; i != n4; i += 4) {
+        // Low 16 bits of each lane: uniform over uint16_t.
+        uint64_t draw[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(draw), rng.next4());
+        for (int j = 0; j != 4; ++j) values[i + j] = static_cast<uint16_t>(draw[j]);
+    }
+    for (uint64_t i = n4; i != n; ++i) {  // tail: at most 3 draws
+        uint64_t draw[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(draw), rng.next4());
+        keys[i] = draw[0];
+        values[i] = static_cast<uint16_t>(draw[1]);
+    }
+}
+
+#else
+
+// Scalar xoshiro256++ fallback for non-AVX2 targets (e.g. ARM64 builds).
+struct xoshiro256pp {
+    uint64_t s[4];
+
+    explicit xoshiro256pp(uint64_t seed) {
+        for (int i = 0; i != 4; ++i) s[i] = splitmix64(seed);
+    }
+
+    static inline uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    inline uint64_t next() {
+        const uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+};
+
+static void fill_random(uint64_t seed, std::vector<uint64_t>& keys,
+                        std::vector<uint16_t>& values) {
+    xoshiro256pp rng(seed);
+    for (uint64_t i = 0; i != keys.size(); ++i) keys[i] = rng.next();
+    for (uint64_t i = 0; i != values.size(); ++i) {
+        values[i] = static_cast<uint16_t>(rng.next());
+    }
+}
+
+#endif
 
 // Generate random keys and values for testing
 int main(int argc, char** argv) {
@@ -13,24 +129,18 @@ int main(int argc, char** argv) {
 
     uint64_t num_keys = std::stoull(argv[1]);
     std::string output_prefix = argv[2];
-    
+
     std::string keys_filename = output_prefix + ".keys.bin";
     std::string values_filename = output_prefix + ".values.bin";
 
-    // Generate random keys
     std::random_device rd;
-    std::mt19937_64 gen(rd());
-    std::uniform_int_distribution<uint64_t> key_dist;
-    std::uniform_int_distribution<uint16_t> value_dist;
+    uint64_t seed = (uint64_t(rd()) << 32) | rd();
 
     std::vector<uint64_t> keys(num_keys);
     std::vector<uint16_t> values(num_keys);
 
     std::cout << "Generating " << num_keys << " random keys and values..." << std::endl;
-    for (uint64_t i = 0; i < num_keys; ++i) {
-        keys[i] = key_dist(gen);
-        values[i] = value_dist(gen);
-    }
+    fill_random(seed, keys, values);
 
     // Save the keys to file
     std::ofstream keys_file(keys_filename, std::ios::binary);
@@ -55,6 +165,6 @@ int main(int argc, char** argv) {
     std::cout << "Generated data saved to:" << std::endl;
     std::cout << "  - " << keys_filename << std::endl;
     std::cout << "  - " << values_filename << std::endl;
-    
+
     return 0;
-} 
\ No newline at end of file
+}
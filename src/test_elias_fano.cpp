@@ -1,8 +1,7 @@
 #include <iostream>
 #include <vector>
+#include <array>
 #include <cstdint>
-#include <numeric>   // For std::iota
-#include <algorithm> // For std::sort, std::lower_bound
 #include <cstdio>    // For fprintf used in instrumentation
 
 // Include necessary PTHash / BITS headers
@@ -13,16 +12,28 @@
 // Note: template args: index_zeros=false, encode_prefix_sum=false
 using ef_type = bits::elias_fano<false, false>;
 
-// Test function for reusable test logic
-void run_test_case(const char* test_name, const std::vector<uint64_t>& data, const std::vector<uint64_t>& test_indices) {
+// elias_fano::encode requires a sorted sequence; the test arrays are constexpr,
+// so enforce it with static_asserts instead of sorting (or asserting) at
+// runtime. (std::is_sorted is not constexpr until C++20.)
+template <size_t N>
+constexpr bool is_sorted_array(const std::array<uint64_t, N>& a) {
+    for (size_t i = 1; i < N; ++i) {
+        if (a[i] < a[i - 1]) return false;
+    }
+    return true;
+}
+
+// Test function for reusable test logic. Takes (pointer, length) views so the
+// constexpr arrays in main() are read in place; no per-case vector copies.
+void run_test_case(const char* test_name, const uint64_t* data, uint64_t num_elements,
+                   const uint64_t* test_indices, uint64_t num_indices) {
     std::cerr << "\n====== " << test_name << " ======" << std::endl;
-    
-    const uint64_t universe = data.back(); // Universe size based on max value
-    const uint64_t num_elements = data.size();
+
+    const uint64_t universe = data[num_elements - 1]; // Universe size based on max value
 
     std::cerr << "Input Data (Sorted): ";
-    for(size_t i = 0; i < data.size(); ++i) {
-        std::cerr << data[i] << (i == data.size() - 1 ? "" : ", ");
+    for(size_t i = 0; i < num_elements; ++i) {
+        std::cerr << data[i] << (i == num_elements - 1 ? "" : ", ");
         if (i > 0 && i % 10 == 0) {
             std::cerr << "\n                   ";
         }
@@ -34,7 +45,7 @@ void run_test_case(const char* test_name, const std::vector<uint64_t>& data, con
     // Instantiate and Encode Elias-Fano
     std::cerr << "\n--- Encoding Elias-Fano ---" << std::endl;
     ef_type ef;
-    ef.encode(data.begin(), num_elements, universe);
+    ef.encode(data, num_elements, universe);
     std::cerr << "--- Encoding Complete ---" << std::endl;
 
     // === UPDATED EXPLICIT LOGGING HERE ===
@@ -42,36 +53,40 @@ void run_test_case(const char* test_name, const std::vector<uint64_t>& data, con
     std::cerr << "ef.size() (m_low_bits.size()): " << ef.size() << std::endl;
     std::cerr << "ef.back() (m_back): " << ef.back() << std::endl;
 
+    // Accessor results hoisted once: GCC does not CSE the repeated
+    // get_*_bits().data() chains across iostream statements, so each
+    // insertion was re-walking the accessors.
+    const auto& high_data = ef.get_high_bits().data();
+    const auto& low_bits = ef.get_low_bits();
+    const auto& low_data = low_bits.data();
+    const uint64_t l = low_bits.width();
+
     // --- HighBits ---
     std::cerr << "ef.m_high_bits.num_bits(): " << ef.get_high_bits().num_bits() << std::endl;
-    std::cerr << "ef.m_high_bits.data().size(): " << ef.get_high_bits().data().size() << std::endl;
-    if (!ef.get_high_bits().data().empty()) {
-        std::cerr << "ef.m_high_bits.data(): [";
-        for (size_t i = 0; i < ef.get_high_bits().data().size(); ++i) {
-            std::cerr << "0x" << std::hex << ef.get_high_bits().data()[i] << std::dec << (i == ef.get_high_bits().data().size() - 1 ? "" : ", ");
-        }
-        std::cerr << "]" << std::endl;
-    } else {
-        std::cerr << "ef.m_high_bits.data(): []" << std::endl;
+    std::cerr << "ef.m_high_bits.data().size(): " << high_data.size() << std::endl;
+    // fprintf for the hex dumps: one formatted write per word instead of
+    // four facet-dispatching manipulator insertions
+    fprintf(stderr, "ef.m_high_bits.data(): [");
+    for (size_t i = 0; i < high_data.size(); ++i) {
+        fprintf(stderr, "0x%llx%s", (unsigned long long)high_data[i],
+                i == high_data.size() - 1 ? "" : ", ");
     }
+    fprintf(stderr, "]\n");
 
     // --- LowBits ---
-    std::cerr << "ef.m_low_bits.size(): " << ef.get_low_bits().size() << std::endl;
-    std::cerr << "ef.m_low_bits.width(): " << ef.get_low_bits().width() << std::endl;
-    std::cerr << "ef.m_low_bits.mask(): 0x" << std::hex << ((ef.get_low_bits().width() == 64) ? uint64_t(-1) : ((uint64_t(1) << ef.get_low_bits().width()) - 1)) << std::dec << std::endl;
-    std::cerr << "ef.m_low_bits.data().size(): " << ef.get_low_bits().data().size() << std::endl;
-    if (!ef.get_low_bits().data().empty()) {
-        std::cerr << "ef.m_low_bits.data(): [";
-        for (size_t i = 0; i < ef.get_low_bits().data().size(); ++i) {
-            std::cerr << "0x" << std::hex << ef.get_low_bits().data()[i] << std::dec << (i == ef.get_low_bits().data().size() - 1 ? "" : ", ");
-        }
-        std::cerr << "]" << std::endl;
-    } else {
-        std::cerr << "ef.m_low_bits.data(): []" << std::endl;
+    std::cerr << "ef.m_low_bits.size(): " << low_bits.size() << std::endl;
+    std::cerr << "ef.m_low_bits.width(): " << l << std::endl;
+    fprintf(stderr, "ef.m_low_bits.mask(): 0x%llx\n",
+            (unsigned long long)((l == 64) ? uint64_t(-1) : ((uint64_t(1) << l) - 1)));
+    std::cerr << "ef.m_low_bits.data().size(): " << low_data.size() << std::endl;
+    fprintf(stderr, "ef.m_low_bits.data(): [");
+    for (size_t i = 0; i < low_data.size(); ++i) {
+        fprintf(stderr, "0x%llx%s", (unsigned long long)low_data[i],
+                i == low_data.size() - 1 ? "" : ", ");
     }
+    fprintf(stderr, "]\n");
 
     // Formula used for m_high_bits.num_bits() calculation
-    uint64_t l = ef.get_low_bits().width();
     uint64_t n = ef.size();
     std::cerr << std::dec << "Calculated m_high_bits.num_bits() using formula: n + (universe >> l) + 1 = " 
               << n << " + (" << universe << " >> " << l << ") + 1 = "
@@ -83,7 +98,8 @@ void run_test_case(const char* test_name, const std::vector<uint64_t>& data, con
     std::cerr << "\n--- Testing ef.access(i) ---" << std::endl;
 
     bool all_passed = true;
-    for (uint64_t test_index : test_indices) {
+    for (uint64_t k = 0; k != num_indices; ++k) {
+        uint64_t test_index = test_indices[k];
         if (test_index >= num_elements) {
             std::cerr << "Skipping test_index " << test_index << " (out of bounds)" << std::endl;
             continue;
@@ -110,6 +126,30 @@ void run_test_case(const char* test_name, const std::vector<uint64_t>& data, con
         }
     }
 
+    // Test access_many: the batched path pipelines the darray inventory and
+    // low-bits prefetches across the batch, so exercise it on the same
+    // indices and check it agrees with the scalar access calls above.
+    std::cerr << "\n--- Testing ef.access_many(is, n, out) ---" << std::endl;
+    std::vector<uint64_t> batch_indices;
+    batch_indices.reserve(num_indices);
+    for (uint64_t k = 0; k != num_indices; ++k) {
+        if (test_indices[k] < num_elements) batch_indices.push_back(test_indices[k]);
+    }
+    std::vector<uint64_t> batch_out(batch_indices.size());
+    ef.access_many(batch_indices.data(), batch_indices.size(), batch_out.data());
+    for (size_t k = 0; k != batch_indices.size(); ++k) {
+        uint64_t expected_value = data[batch_indices[k]];
+        std::cout << test_name << " - Batch Index: " << batch_indices[k]
+                  << ", Expected: " << expected_value
+                  << ", Got: " << batch_out[k];
+        if (batch_out[k] == expected_value) {
+            std::cout << " -> PASS" << std::endl;
+        } else {
+            std::cout << " -> FAIL" << std::endl;
+            all_passed = false;
+        }
+    }
+
     std::cerr << "\n--- Test Summary for " << test_name << " ---" << std::endl;
     if (all_passed) {
         std::cerr << "All access tests passed!" << std::endl;
@@ -124,53 +164,65 @@ int main() {
 
     // ======== TEST CASE 1: BASIC TEST ========
     // Basic test with small data and common case
-    std::vector<uint64_t> basic_data = {3, 8, 10, 15, 21, 22, 30, 31, 45, 50};
-    std::vector<uint64_t> basic_test_indices = {0, 3, 5, 9};
-    run_test_case("BASIC TEST", basic_data, basic_test_indices);
-    
+    static constexpr std::array<uint64_t, 10> basic_data = {3, 8, 10, 15, 21, 22, 30, 31, 45, 50};
+    static_assert(is_sorted_array(basic_data), "EF input must be sorted");
+    static constexpr std::array<uint64_t, 4> basic_test_indices = {0, 3, 5, 9};
+    run_test_case("BASIC TEST", basic_data.data(), basic_data.size(),
+                  basic_test_indices.data(), basic_test_indices.size());
+
     // ======== TEST CASE 2: MULTI-WORD COMPACT VECTOR TEST ========
     // Force shift + m_width > 64 in compact_vector::access
-    std::vector<uint64_t> multi_word_data;
     // Create data with large universe to force l (low bits width) to be large
-    // Goal: l ≈ 12 bits
-    uint64_t universe_size = 50000;
-    for (uint64_t i = 0; i < 10; i++) {
-        multi_word_data.push_back(i * (universe_size / 10) + (i+1)*100);  // Create values spread out in range
-    }
-    // Ensure the data is sorted
-    std::sort(multi_word_data.begin(), multi_word_data.end());
-    
+    // Goal: l ≈ 12 bits. The generator is strictly increasing (step 5000+100),
+    // so the array is born sorted and can live in .rodata.
+    static constexpr std::array<uint64_t, 10> multi_word_data = []() {
+        std::array<uint64_t, 10> a{};
+        constexpr uint64_t universe_size = 50000;
+        for (uint64_t i = 0; i < a.size(); i++) {
+            a[i] = i * (universe_size / 10) + (i + 1) * 100;  // Create values spread out in range
+        }
+        return a;
+    }();
+    static_assert(is_sorted_array(multi_word_data), "EF input must be sorted");
+
     // Test i=5 (pos=i*l=5*12=60, shift=60, shift+width=72) and i=6 (pos=6*12=72, block=1, shift=8)
-    std::vector<uint64_t> multi_word_indices = {5, 6};
-    run_test_case("MULTI-WORD COMPACT VECTOR TEST", multi_word_data, multi_word_indices);
-    
+    static constexpr std::array<uint64_t, 2> multi_word_indices = {5, 6};
+    run_test_case("MULTI-WORD COMPACT VECTOR TEST", multi_word_data.data(), multi_word_data.size(),
+                  multi_word_indices.data(), multi_word_indices.size());
+
     // ======== TEST CASE 3: DARRAY INVENTORY TEST ========
     // Force select to use the inventory system by creating enough values
-    // to push data beyond first word
-    std::vector<uint64_t> large_data;
-    // Create 200+ elements with a reasonably large universe
-    uint64_t large_universe = 10000;
-    for (uint64_t i = 0; i < 250; i++) {
-        large_data.push_back(i * (large_universe / 250) + i*2);  // Spread values
-    }
-    // Ensure the data is sorted
-    std::sort(large_data.begin(), large_data.end());
-    
+    // to push data beyond first word: 250 elements, universe ~10000,
+    // monotonic generator (step 42) so no sort needed.
+    static constexpr std::array<uint64_t, 250> large_data = []() {
+        std::array<uint64_t, 250> a{};
+        constexpr uint64_t large_universe = 10000;
+        for (uint64_t i = 0; i < a.size(); i++) {
+            a[i] = i * (large_universe / 250) + i * 2;  // Spread values
+        }
+        return a;
+    }();
+    static_assert(is_sorted_array(large_data), "EF input must be sorted");
+
     // Test indices well beyond the first word
-    std::vector<uint64_t> inventory_test_indices = {100, 150, 200, 249};
-    run_test_case("DARRAY INVENTORY TEST", large_data, inventory_test_indices);
-    
+    static constexpr std::array<uint64_t, 4> inventory_test_indices = {100, 150, 200, 249};
+    run_test_case("DARRAY INVENTORY TEST", large_data.data(), large_data.size(),
+                  inventory_test_indices.data(), inventory_test_indices.size());
+
     // ======== TEST CASE 4: ZERO LOW BITS TEST (l=0) ========
-    // Create a scenario where universe/n is very small to force l=0
-    std::vector<uint64_t> zero_l_data;
-    // Generate 100 values in a small universe of ~100
-    for (uint64_t i = 0; i < 100; i++) {
-        zero_l_data.push_back(i+1);  // Values 1-100
-    }
-    
+    // Create a scenario where universe/n is very small to force l=0:
+    // 100 values 1-100
+    static constexpr std::array<uint64_t, 100> zero_l_data = []() {
+        std::array<uint64_t, 100> a{};
+        for (uint64_t i = 0; i < a.size(); i++) a[i] = i + 1;
+        return a;
+    }();
+    static_assert(is_sorted_array(zero_l_data), "EF input must be sorted");
+
     // Test various indices
-    std::vector<uint64_t> zero_l_indices = {0, 25, 50, 75, 99};
-    run_test_case("ZERO LOW BITS TEST (l=0)", zero_l_data, zero_l_indices);
+    static constexpr std::array<uint64_t, 5> zero_l_indices = {0, 25, 50, 75, 99};
+    run_test_case("ZERO LOW BITS TEST (l=0)", zero_l_data.data(), zero_l_data.size(),
+                  zero_l_indices.data(), zero_l_indices.size());
     
     // Final summary
     std::cerr << "\n====== FINAL TEST SUMMARY ======" << std::endl;
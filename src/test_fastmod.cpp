@@ -7,12 +7,18 @@
 // Include the header containing fastmod
 #include "fastmod.h" // Use the include path configured in CMakeLists.txt
 
-// Helper to print __uint128_t
+#ifdef __BMI2__
+#include <immintrin.h> // For _mulx_u64
+#endif
+
+// Helper to print __uint128_t. fprintf instead of a std::hex/setw/setfill
+// manipulator chain: the iostream route dispatches through locale facets
+// per insertion, which drowns the arithmetic being probed.
 void print_uint128(const char* label, __uint128_t val) {
     uint64_t high = (uint64_t)(val >> 64);
     uint64_t low = (uint64_t)val;
-    std::cerr << label << "=0x" << std::hex << std::setw(16) << std::setfill('0') << high
-              << std::setw(16) << std::setfill('0') << low << std::dec;
+    fprintf(stderr, "%s=0x%016llx%016llx", label, (unsigned long long)high,
+            (unsigned long long)low);
 }
 
 // Debug version of fastmod_u64
@@ -43,6 +49,35 @@ uint64_t fastmod_u64_debug(uint64_t a, __uint128_t M, uint64_t d) {
      std::cerr << "[C++ fastmod_u64_debug] Return: " << result << std::endl;
      return result;
  }
+// Non-debug variant taking M as explicit high/low words. On BMI2 hardware
+// each 128-bit multiply is a single MULX with named high/low outputs, so the
+// whole mod is four multiplies and one carry add with no 128-bit value
+// marshalled through register pairs. The steps mirror 2/2a/2b/3/4 above.
+#ifdef __BMI2__
+uint64_t fastmod_u64_fast(uint64_t a, uint64_t M_hi, uint64_t M_lo, uint64_t d) {
+    // Step 1: lowbits = M * a mod 2^128
+    unsigned long long hi0, hi1;
+    unsigned long long lowbits_lo = _mulx_u64(M_lo, a, &hi0);
+    unsigned long long lo1 = _mulx_u64(M_hi, a, &hi1); // hi1 is beyond bit 127
+    (void)hi1;
+    unsigned long long lowbits_hi = hi0 + lo1;
+    // Steps 2/2a: (lowbits_lo * d) >> 64
+    unsigned long long bottom_half_shifted;
+    _mulx_u64(lowbits_lo, d, &bottom_half_shifted);
+    // Step 2b: lowbits_hi * d, full 128 bits
+    unsigned long long top_hi;
+    unsigned long long top_lo = _mulx_u64(lowbits_hi, d, &top_hi);
+    // Steps 3/4: top 64 bits of bottom_half_shifted + top half product
+    unsigned long long sum_lo = bottom_half_shifted + top_lo;
+    unsigned long long carry = sum_lo < bottom_half_shifted;
+    return top_hi + carry;
+}
+#else
+uint64_t fastmod_u64_fast(uint64_t a, uint64_t M_hi, uint64_t M_lo, uint64_t d) {
+    __uint128_t M = static_cast<__uint128_t>(M_hi) << 64 | M_lo;
+    return fastmod::fastmod_u64(a, M, d);
+}
+#endif
 } // namespace fastmod_debug
 
 
@@ -116,6 +151,15 @@ int main() {
             overall_pass = false; // Fail the test if debug and original don't match
         }
 
+        // --- Compare intrinsic (MULX) variant vs Original ---
+        uint64_t result_fast = fastmod_debug::fastmod_u64_fast(tc.a, tc.m_high, tc.m_low, tc.d);
+        if (result_fast == result_original) {
+            std::cerr << "C++ Fast == C++ Original: MATCH" << std::endl;
+        } else {
+            std::cerr << "C++ Fast != C++ Original: MISMATCH (got " << result_fast << ")" << std::endl;
+            overall_pass = false;
+        }
+
         // --- Compare Debug vs Expected ---
         bool case_passed = (result_debug == tc.expected_result);
         if (case_passed) {
@@ -258,6 +258,7 @@ template <typename Function, typename Iterator>
 double perf(Iterator keys, const uint64_t num_queries, Function const& f) {
     static const uint64_t runs = 5;
     essentials::timer<std::chrono::high_resolution_clock, std::chrono::nanoseconds> t;
+    t.reserve(runs);
     t.start();
     for (uint64_t r = 0; r != runs; ++r) {
         Iterator begin = keys;
@@ -0,0 +1,63 @@
+#include "common.hpp"
+
+#include <cstdio>
+
+using namespace pthash;
+
+/*
+    Round-trip through the custom-allocator load path: save a PHF, load it
+    back both with the stream loader and with
+    essentials::contiguous_memory_allocator::allocate, and require identical
+    lookups. Guards against the allocator path silently producing zeroed
+    containers instead of the serialized payloads.
+*/
+
+using phf_type = single_phf<murmurhash2_64, skew_bucketer, dictionary_dictionary,
+                            true,  // minimal
+                            pthash_search_type::add_displacement>;
+
+int main() {
+    static const uint64_t universe = 100000;
+    const char* tmp_filename = "test_custom_allocator_load.tmp.bin";
+
+    for (int i = 0; i != 3; ++i) {
+        uint64_t num_keys = random_value() % universe;
+        if (num_keys == 0) num_keys = 1;
+        std::vector<uint64_t> keys = distinct_uints<uint64_t>(num_keys, random_value());
+        std::cout << "testing on " << num_keys << " keys..." << std::endl;
+
+        build_configuration config;
+        config.search = pthash_search_type::add_displacement;
+        config.minimal = true;
+        config.verbose = false;
+        config.seed = random_value();
+        config.alpha = 0.97;
+        config.lambda = 4.0;
+
+        phf_type f;
+        f.build_in_internal_memory(keys.begin(), keys.size(), config);
+        essentials::save(f, tmp_filename);
+
+        phf_type f_stream;
+        essentials::load(f_stream, tmp_filename);
+
+        phf_type f_alloc;
+        essentials::contiguous_memory_allocator allocator;
+        size_t loaded_bytes = allocator.allocate(f_alloc, tmp_filename);
+        testing::require_equal(loaded_bytes, essentials::load(f_stream, tmp_filename));
+
+        testing::require_equal(f_alloc.num_keys(), f.num_keys());
+        testing::require_equal(f_alloc.table_size(), f.table_size());
+        for (auto const& key : keys) {
+            testing::require_equal(f_alloc(key), f(key));
+            testing::require_equal(f_alloc(key), f_stream(key));
+        }
+        if (!check(keys.begin(), f_alloc)) {
+            std::remove(tmp_filename);
+            throw std::runtime_error("check failed on allocator-loaded PHF");
+        }
+    }
+
+    std::remove(tmp_filename);
+    return 0;
+}